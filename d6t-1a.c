@@ -33,6 +33,14 @@
 #include <linux/i2c-dev.h>
 #include <stdbool.h>
 #include <time.h>
+#include <stdlib.h>
+#include "d6t-filter.h"
+#include "d6t-calib.h"
+#include "d6t-stamp.h"
+#include "d6t-phase.h"
+#include "d6t-health.h"
+#include "d6t-log.h"
+#include "d6t-rule.h"
 
 /* defines */
 #define D6T_ADDR 0x0A  // for I2C 7bit address
@@ -47,6 +55,8 @@
 uint8_t rbuf[N_READ];
 double ptat;
 double pix_data[N_PIXEL];
+int16_t pix_raw[N_PIXEL];
+d6t_stamp_t stamp;  // acquisition time of rbuf
 
 /* I2C functions */
 /** <!-- i2c_read_reg8 {{{1 --> I2C read function for bytes transfer.
@@ -66,11 +76,14 @@ uint32_t i2c_read_reg8(uint8_t devAddr, uint8_t regAddr,
             fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
             err = 22; break;
         }
+        d6t_stamp_begin(&stamp);
         if (write(fd, &regAddr, 1) != 1) {
+            d6t_stamp_end(&stamp);  // not the stamp of the last frame.
             fprintf(stderr, "Failed to write reg: %s\n", strerror(errno));
             err = 23; break;
         }
         int count = read(fd, data, length);
+        d6t_stamp_end(&stamp);
         if (count < 0) {
             fprintf(stderr, "Failed to read device(%d): %s\n",
                     count, strerror(errno));
@@ -161,34 +174,179 @@ void initialSetting(void) {
 
 /** <!-- main - Thermal sensor {{{1 -->
  * Read data
+ *
+ * options:
+ *   -f filter:   temporal filter, ema:shift, mean:frames or median:frames.
+ *   -c file:     per-pixel calibration file, applied on the conversion.
+ *   -T:          prefix the frames with the acquisition time (monotonic
+ *                midpoint of the I2C transfer) and the transfer time.
+ *   -R:          add the CLOCK_REALTIME midpoint to the timestamp.
+ *   -P:          phase-locked polling, read just after the sensor refresh
+ *                and skip the duplicated frames.
+ *   -A:          report duplicates and data age with the fixed delay.
+ *   -H:          health monitor, drop PEC-failing, out of range or stuck
+ *                frames and initialize the sensor again if they continue.
+ *   -o file:     write the output to a file by a writer thread, the
+ *                reading is not blocked by the disk.
+ *   -F msec:     longest time of the output in the buffers (default 1000).
+ *   -S sync:     durability of the file, none (default), data or full.
+ *   -a file:     alarm rule file, the raised and cleared alarms are output
+ *                as `ALARM:` lines with the frame time.
  */
-int main() {
+int main(int argc, char* argv[]) {
     int i;
 	int16_t itemp;
+	int opt;
+	static d6t_filter_t filter;
+	const char* filter_spec = NULL;
+	static d6t_calib_t calib;
+	bool calibrated = false;
+	bool stamped = false, real = false;
+	char ts[80] = "";
+	static d6t_phase_t phase;
+	bool tracked = false, locked = false;
+	static d6t_health_t health;
+	bool monitored = false;
+	static d6t_log_t logger;
+	const char* log_path = NULL;
+	const char* log_sync = NULL;
+	int log_flush = 1000;
+	FILE* out = stdout;
+	static d6t_rules_t rules;
+	bool alarmed = false;
+	char alarm[256];
+
+	while ((opt = getopt(argc, argv, "f:c:TRPAHo:F:S:a:")) != -1) {
+		switch (opt) {
+		case 'f': filter_spec = optarg; break;
+		case 'c':
+			if (d6t_calib_load(&calib, optarg, N_PIXEL, 10.0)) {
+				return 1;
+			}
+			calibrated = true;
+			break;
+		case 'T': stamped = true; break;
+		case 'R': stamped = real = true; break;
+		case 'P': tracked = locked = true; break;
+		case 'A': tracked = true; break;
+		case 'H': monitored = true; break;
+		case 'o': log_path = optarg; break;
+		case 'F': log_flush = atoi(optarg); break;
+		case 'S': log_sync = optarg; break;
+		case 'a':
+			if (d6t_rules_load(&rules, optarg, N_ROW, N_PIXEL, 10)) {
+				return 1;
+			}
+			alarmed = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f filter] [-c file] [-T] [-R]"
+			        " [-P] [-A] [-H] [-o file] [-F msec] [-S sync]"
+			        " [-a file]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (d6t_filter_init(&filter, filter_spec, N_PIXEL)) {
+		return 1;
+	}
+	if (log_path != NULL) {
+		if (d6t_log_open(&logger, log_path, log_flush, log_sync)) {
+			return 1;
+		}
+		if ((out = d6t_log_fopen(&logger)) == NULL) {
+			d6t_log_close(&logger);
+			return 1;
+		}
+		d6t_log_trap();  // close the log on SIGINT and SIGTERM.
+	}
+	d6t_health_init(&health, N_PIXEL);
+	d6t_phase_init(&phase, 100, locked);
 	
 	delay(220);	
 	
-	while(1){
+	while (!d6t_log_stopping) {
 		// Read data via I2C
 		memset(rbuf, 0, N_READ);
 		uint32_t ret = i2c_read_reg8(D6T_ADDR, D6T_CMD, rbuf, N_READ);
-		D6T_checkPEC(rbuf, N_READ - 1);
+		bool pec_err = D6T_checkPEC(rbuf, N_READ - 1);
+		if (stamped) {
+			d6t_stamp_sprint(&stamp, real, ts, sizeof(ts));
+		}
+
+		// Drop bad frames, initialize the sensor again if they continue
+		if (monitored) {
+			int state = d6t_health_check(&health, rbuf, N_READ, !pec_err,
+			                             d6t_stamp_mid(&stamp));
+			if (state == D6T_HEALTH_REINIT) {
+				fprintf(stderr, "re-initialize: %s\n", health.reason);
+				initialSetting();
+				delay(220);
+				d6t_filter_reset(&filter);
+			} else if (state == D6T_HEALTH_RECOVERED) {
+				d6t_health_report(&health, stderr);
+				state = D6T_HEALTH_OK;
+			}
+			if (state != D6T_HEALTH_OK) {
+				d6t_phase_skip(&phase, d6t_stamp_mid(&stamp));
+				d6t_phase_wait(&phase);
+				continue;
+			}
+		}
+
+		// Track the sensor refresh, skip duplicates if phase-locked
+		if (tracked) {
+			bool fresh = d6t_phase_update(&phase, rbuf, N_READ,
+			                              d6t_stamp_mid(&stamp));
+			if ((phase.n_new + phase.n_dup) % 100 == 0) {
+				d6t_phase_report(&phase, stderr);
+			}
+			if (!fresh && locked) {
+				d6t_phase_wait(&phase);
+				continue;
+			}
+		}
 		
         //Convert to temperature data (degC)
 		ptat = (double)conv8us_s16_le(rbuf, 0) / 10.0;
+		if (calibrated) {
+			d6t_calib_decode(&calib, rbuf, pix_raw);
+		} else {
+			for (i = 0; i < N_PIXEL; i++) {
+				itemp = conv8us_s16_le(rbuf, 2 + 2*i);
+				pix_raw[i] = itemp;
+			}
+		}
+		d6t_filter_apply(&filter, pix_raw, pix_raw);
+
+		// Evaluate the alarm rules, output the raised and cleared alarms
+		if (alarmed) {
+			int k, n = d6t_rules_eval(&rules, conv8us_s16_le(rbuf, 0),
+			                          pix_raw);
+			for (k = 0; k < n; k++) {
+				if (d6t_rules_sprint(&rules, k, d6t_stamp_mid(&stamp),
+				                     alarm, sizeof(alarm)) > 0) {
+					fputs(alarm, out);
+				}
+			}
+		}
 		for (i = 0; i < N_PIXEL; i++) {
-			itemp = conv8us_s16_le(rbuf, 2 + 2*i);
-			pix_data[i] = (double)itemp / 10.0;
+			pix_data[i] = (double)pix_raw[i] / 10.0;
 		}
 		
         //Output results		
-		printf("PTAT: %4.1f [degC], Temperature: ", ptat);
+		fprintf(out, "%sPTAT: %4.1f [degC], Temperature: ", ts, ptat);
 		for (i = 0; i < N_PIXEL; i++) {
-		    printf("%4.1f, ", pix_data[i]);
+		    fprintf(out, "%4.1f, ", pix_data[i]);
 		}
-		printf("[degC]\n");
+		fprintf(out, "[degC]\n");
 		
-		delay(100);
+		d6t_phase_wait(&phase);
+	}
+	if (log_path != NULL) {
+		fclose(out);
+		d6t_log_close(&logger);
+		d6t_log_report(&logger, stderr);
 	}
+	return 0;
 }
 // vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -34,6 +34,18 @@
 #include <stdbool.h>
 #include <time.h>
 #include <linux/i2c.h> //add
+#include <stdlib.h>
+#include "d6t-delta.h"
+#include "d6t-roi.h"
+#include "d6t-filter.h"
+#include "d6t-calib.h"
+#include "d6t-stamp.h"
+#include "d6t-phase.h"
+#include "d6t-health.h"
+#include "d6t-log.h"
+#include "d6t-rule.h"
+#include "d6t-flow.h"
+#include "d6t-pyramid.h"
 
 /* defines */
 #define D6T_ADDR 0x0A  // for I2C 7bit address
@@ -49,6 +61,8 @@
 uint8_t rbuf[N_READ];
 double ptat;
 double pix_data[N_PIXEL];
+int16_t pix_raw[N_PIXEL];
+d6t_stamp_t stamp;  // acquisition time of rbuf
 
 /******* setting parameter *******/
 #define D6T_IIR 0x00 
@@ -73,7 +87,10 @@ uint32_t i2c_read_reg8(uint8_t devAddr, uint8_t regAddr,
 			{ devAddr, I2C_M_RD, length, data },
 		};
 		struct i2c_rdwr_ioctl_data ioctl_data = { messages, 2 };
-		if (ioctl(fd, I2C_RDWR, &ioctl_data) != 2) {
+		d6t_stamp_begin(&stamp);
+		int ret = ioctl(fd, I2C_RDWR, &ioctl_data);
+		d6t_stamp_end(&stamp);
+		if (ret != 2) {
 			fprintf(stderr, "i2c_read: failed to ioctl: %s\n", strerror(errno));
 		}
 
@@ -156,17 +173,190 @@ void initialSetting(void) {
 /** <!-- main - Thermal sensor {{{1 -->
  * 1. Initialize.
  * 2. Read data
+ *
+ * options:
+ *   -d deadband: change-only output, per-pixel deadband in 0.1 degC.
+ *   -t tile:     tile edge in pixels for change-only output (default 8).
+ *   -k frames:   keyframe interval for change-only output (default 30).
+ *   -r roi:      output a region only, name=x,y,w,h or name=@maskfile,
+ *                can be repeated for several regions.
+ *   -s:          output min/max/mean of the regions instead of pixels.
+ *   -f filter:   temporal filter, ema:shift, mean:frames or median:frames.
+ *   -c file:     per-pixel calibration file, applied on the conversion.
+ *   -T:          prefix the frames with the acquisition time (monotonic
+ *                midpoint of the I2C transfer) and the transfer time.
+ *   -R:          add the CLOCK_REALTIME midpoint to the timestamp.
+ *   -P:          phase-locked polling, read just after the sensor refresh
+ *                and skip the duplicated frames.
+ *   -A:          report duplicates and data age with the fixed delay.
+ *   -H:          health monitor, drop PEC-failing, out of range or stuck
+ *                frames and initialize the sensor again if they continue.
+ *   -l rows:     output the frame decimated to 16, 8 or 4 rows instead of
+ *                the full grid, can be repeated for several levels.
+ *   -p pool:     decimation by box (mean, default) or max pooling.
+ *   -o file:     write the output to a file by a writer thread, the
+ *                reading is not blocked by the disk.
+ *   -F msec:     longest time of the output in the buffers (default 1000).
+ *   -S sync:     durability of the file, none (default), data or full.
+ *   -a file:     alarm rule file, the raised and cleared alarms are output
+ *                as `ALARM:` lines with the frame time.
+ *   -m block:    motion vectors by block matching, block[,range] in
+ *                pixels (range 1 to 3, default 2), output as `FLOW:` lines
+ *                of the block vectors and the motion of the regions.
+ *   -v roi:      region of the motion, name=x,y,w,h or name=@maskfile,
+ *                can be repeated (default the whole frame).
  */
-int main() {
+int main(int argc, char* argv[]) {
     int i;
 	int16_t itemp;
-	
+	int opt;
+	int deadband = -1, tile = 8, keyframe = 30;
+	static d6t_delta_t delta;
+	static char line[D6T_DELTA_LINE_MAX];
+	static d6t_roi_t roi[D6T_ROI_MAX];
+	static int16_t roi_raw[D6T_ROI_MAX_PIXEL];
+	int n_roi = 0;
+	bool summary = false;
+	static d6t_filter_t filter;
+	static d6t_filter_t roi_filter[D6T_ROI_MAX];
+	const char* filter_spec = NULL;
+	static d6t_calib_t calib;
+	bool calibrated = false;
+	bool stamped = false, real = false;
+	char ts[80] = "";
+	static d6t_phase_t phase;
+	bool tracked = false, locked = false;
+	static d6t_health_t health;
+	bool monitored = false;
+	static d6t_log_t logger;
+	const char* log_path = NULL;
+	const char* log_sync = NULL;
+	int log_flush = 1000;
+	FILE* out = stdout;
+	static d6t_rules_t rules;
+	bool alarmed = false;
+	char alarm[256];
+	static d6t_flow_t flow;
+	bool flowing = false;
+	int block = 0, range = 2;
+	static d6t_roi_t zone[D6T_ROI_MAX];
+	int j, n_zone = 0;
+	static d6t_pyramid_t pyramid;
+	const char* pool = NULL;
+	int level[D6T_PYRAMID_MAX_LEVEL], n_level = 0;
+
+	while ((opt = getopt(argc, argv, "d:t:k:r:sf:c:TRPAHl:p:o:F:S:a:m:v:")) != -1) {
+		switch (opt) {
+		case 'd': deadband = atoi(optarg); break;
+		case 't': tile = atoi(optarg); break;
+		case 'k': keyframe = atoi(optarg); break;
+		case 'r':
+			if (n_roi >= D6T_ROI_MAX ||
+			    d6t_roi_parse(&roi[n_roi], optarg, N_ROW)) {
+				return 1;
+			}
+			n_roi++;
+			break;
+		case 's': summary = true; break;
+		case 'f': filter_spec = optarg; break;
+		case 'c':
+			if (d6t_calib_load(&calib, optarg, N_PIXEL, 10.0)) {
+				return 1;
+			}
+			calibrated = true;
+			break;
+		case 'T': stamped = true; break;
+		case 'R': stamped = real = true; break;
+		case 'P': tracked = locked = true; break;
+		case 'A': tracked = true; break;
+		case 'H': monitored = true; break;
+		case 'l':
+			if (n_level >= D6T_PYRAMID_MAX_LEVEL) {
+				return 1;
+			}
+			level[n_level++] = atoi(optarg);  // rows, checked below
+			break;
+		case 'p': pool = optarg; break;
+		case 'o': log_path = optarg; break;
+		case 'F': log_flush = atoi(optarg); break;
+		case 'S': log_sync = optarg; break;
+		case 'a':
+			if (d6t_rules_load(&rules, optarg, N_ROW, N_PIXEL, 10)) {
+				return 1;
+			}
+			alarmed = true;
+			break;
+		case 'm':
+			if (sscanf(optarg, "%d,%d", &block, &range) < 1) {
+				return 1;
+			}
+			flowing = true;
+			break;
+		case 'v':
+			if (n_zone >= D6T_ROI_MAX ||
+			    d6t_roi_parse(&zone[n_zone], optarg, N_ROW)) {
+				return 1;
+			}
+			n_zone++;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d deadband] [-t tile] [-k frames]"
+			        " [-r name=x,y,w,h] [-s] [-f filter] [-c file]"
+			        " [-T] [-R] [-P] [-A] [-H] [-l rows] [-p box|max]"
+			        " [-o file] [-F msec] [-S sync] [-a file]"
+			        " [-m block[,range]] [-v name=x,y,w,h]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (alarmed && n_roi > 0) {
+		fprintf(stderr, "-a works on the full frame, use zones for -r\n");
+		return 1;
+	}
+	if (flowing && n_roi > 0) {
+		fprintf(stderr, "-m works on the full frame, use -v for regions\n");
+		return 1;
+	}
+	if (flowing && d6t_flow_init(&flow, N_ROW, 1, block, range)) {
+		return 1;
+	}
+	if (d6t_filter_init(&filter, filter_spec, N_PIXEL)) {
+		return 1;
+	}
+	if (d6t_pyramid_init(&pyramid, N_ROW, pool)) {
+		return 1;
+	}
+	for (i = 0; i < n_level; i++) {  // rows to the level index.
+		if ((level[i] = d6t_pyramid_request(&pyramid, level[i])) < 0) {
+			return 1;
+		}
+	}
+	if (log_path != NULL) {
+		if (d6t_log_open(&logger, log_path, log_flush, log_sync)) {
+			return 1;
+		}
+		if ((out = d6t_log_fopen(&logger)) == NULL) {
+			d6t_log_close(&logger);
+			return 1;
+		}
+		d6t_log_trap();  // close the log on SIGINT and SIGTERM.
+	}
+	d6t_health_init(&health, N_PIXEL);
+	d6t_phase_init(&phase, 200, locked);
+	for (i = 0; i < n_roi; i++) {  // a filter state per region.
+		d6t_filter_init(&roi_filter[i], filter_spec, roi[i].n);
+	}
+	if (deadband >= 0 &&
+	    d6t_delta_init(&delta, N_ROW, tile, deadband, keyframe)) {
+		fprintf(stderr, "tile must divide %d\n", N_ROW);
+		return 1;
+	}
+
 	delay(350);	
 	// 1. Initialize
 	initialSetting();
     delay(390);	
 	
-	while(1){
+	while (!d6t_log_stopping) {
 		// 2. Read data
 		// Read data via I2C
 		memset(rbuf, 0, N_READ);
@@ -182,23 +372,164 @@ int main() {
 				delay(60);
 			}
 		}
-		D6T_checkPEC(rbuf, N_READ - 1);
+		bool pec_err = D6T_checkPEC(rbuf, N_READ - 1);
+		if (stamped) {
+			d6t_stamp_sprint(&stamp, real, ts, sizeof(ts));
+		}
+
+		// Drop bad frames, initialize the sensor again if they continue
+		if (monitored) {
+			int state = d6t_health_check(&health, rbuf, N_READ, !pec_err,
+			                             d6t_stamp_mid(&stamp));
+			if (state == D6T_HEALTH_REINIT) {
+				fprintf(stderr, "re-initialize: %s\n", health.reason);
+				initialSetting();
+				delay(390);
+				d6t_filter_reset(&filter);
+				d6t_flow_reset(&flow);
+				for (i = 0; i < n_roi; i++) {
+					d6t_filter_reset(&roi_filter[i]);
+				}
+			} else if (state == D6T_HEALTH_RECOVERED) {
+				d6t_health_report(&health, stderr);
+				state = D6T_HEALTH_OK;
+			}
+			if (state != D6T_HEALTH_OK) {
+				d6t_phase_skip(&phase, d6t_stamp_mid(&stamp));
+				d6t_phase_wait(&phase);
+				continue;
+			}
+		}
+
+		// Track the sensor refresh, skip duplicates if phase-locked
+		if (tracked) {
+			bool fresh = d6t_phase_update(&phase, rbuf, N_READ,
+			                              d6t_stamp_mid(&stamp));
+			if ((phase.n_new + phase.n_dup) % 100 == 0) {
+				d6t_phase_report(&phase, stderr);
+			}
+			if (!fresh && locked) {
+				d6t_phase_wait(&phase);
+				continue;
+			}
+		}
 		
+		//Convert and output the regions only
+		if (n_roi > 0) {
+			for (j = 0; j < n_roi; j++) {
+				if (calibrated) {
+					d6t_calib_decode_idx(&calib, rbuf, roi[j].idx, roi[j].n,
+					                     roi_raw);
+				} else {
+					d6t_roi_decode(&roi[j], rbuf, roi_raw);
+				}
+				d6t_filter_apply(&roi_filter[j], roi_raw, roi_raw);
+				if (d6t_roi_sprint(&roi[j], conv8us_s16_le(rbuf, 0), roi_raw,
+				                   summary, line, sizeof(line)) > 0) {
+					fputs(ts, out);
+					fputs(line, out);
+				}
+			}
+			d6t_phase_wait(&phase);
+			continue;
+		}
+
         //Convert to temperature data (degC)
 		ptat = (double)conv8us_s16_le(rbuf, 0) / 10.0;
+		if (calibrated) {
+			d6t_calib_decode(&calib, rbuf, pix_raw);
+		} else {
+			for (i = 0; i < N_PIXEL; i++) {
+				itemp = conv8us_s16_le(rbuf, 2 + 2*i);
+				pix_raw[i] = itemp;
+			}
+		}
+		d6t_filter_apply(&filter, pix_raw, pix_raw);
+
+		// Evaluate the alarm rules, output the raised and cleared alarms
+		if (alarmed) {
+			int k, n = d6t_rules_eval(&rules, conv8us_s16_le(rbuf, 0),
+			                          pix_raw);
+			for (k = 0; k < n; k++) {
+				if (d6t_rules_sprint(&rules, k, d6t_stamp_mid(&stamp),
+				                     alarm, sizeof(alarm)) > 0) {
+					fputs(alarm, out);
+				}
+			}
+		}
+
+		// Estimate the motion from the last frame
+		if (flowing) {
+			d6t_flow_update(&flow, pix_raw);
+			if (d6t_flow_sprint_field(&flow, line, sizeof(line)) > 0) {
+				fputs(ts, out);
+				fputs(line, out);
+			}
+			for (j = 0; j < (n_zone > 0 ? n_zone : 1); j++) {
+				if (d6t_flow_sprint_roi(&flow, n_zone > 0 ? &zone[j] : NULL,
+				                        line, sizeof(line)) > 0) {
+					fputs(ts, out);
+					fputs(line, out);
+				}
+			}
+		}
 		for (i = 0; i < N_PIXEL; i++) {
-			itemp = conv8us_s16_le(rbuf, 2 + 2*i);
-			pix_data[i] = (double)itemp / 10.0;
+			pix_data[i] = (double)pix_raw[i] / 10.0;
+		}
+
+		//Output the decimated levels only
+		if (n_level > 0) {
+			int k;
+			d6t_pyramid_build(&pyramid, pix_raw);
+			for (j = 0; j < n_level; j++) {
+				int rows = N_ROW >> (level[j] + 1);
+				fputs(ts, out);  // the timestamp first, as the ROI lines.
+				if (n_level > 1) {
+					fprintf(out, "%dx%d: ", rows, rows);
+				}
+				fprintf(out, "PTAT: %4.1f [degC], Temperature: ", ptat);
+				for (k = 0; k < rows * rows; k++) {
+					fprintf(out, "%4.1f, ",
+					        (double)pyramid.lvl[level[j]][k] / 10.0);
+				}
+				fprintf(out, "[degC]\n");
+			}
+			d6t_phase_wait(&phase);
+			continue;
 		}
 		
+		//Output changed tiles only
+		if (deadband >= 0) {
+			bool key;
+			d6t_delta_encode(&delta, conv8us_s16_le(rbuf, 0), pix_raw, &key);
+			if (d6t_delta_sprint(&delta, line, sizeof(line), key) < 0) {
+				// the tiles are latched already, resync by a keyframe.
+				fprintf(stderr, "delta line too long, keyframe sent\n");
+				delta.valid = false;
+				d6t_delta_encode(&delta, conv8us_s16_le(rbuf, 0), pix_raw,
+				                 &key);
+				d6t_delta_sprint(&delta, line, sizeof(line), key);
+			}
+			fputs(ts, out);
+			fputs(line, out);
+			d6t_phase_wait(&phase);
+			continue;
+		}
+
         //Output results		
-		printf("PTAT: %4.1f [degC], Temperature: ", ptat);
+		fprintf(out, "%sPTAT: %4.1f [degC], Temperature: ", ts, ptat);
 		for (i = 0; i < N_PIXEL; i++) {
-		    printf("%4.1f, ", pix_data[i]);
+		    fprintf(out, "%4.1f, ", pix_data[i]);
 		}
-		printf("[degC]\n");
+		fprintf(out, "[degC]\n");
 		
-		delay(200);
+		d6t_phase_wait(&phase);
+	}
+	if (log_path != NULL) {
+		fclose(out);
+		d6t_log_close(&logger);
+		d6t_log_report(&logger, stderr);
 	}
+	return 0;
 }
 // vi: ft=c:fdm=marker:et:sw=4:tw=80
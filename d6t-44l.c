@@ -33,7 +33,16 @@
 #include <linux/i2c-dev.h>
 #include <stdbool.h>
 #include <time.h>
+#include <stdlib.h>
 #include <linux/i2c.h> //add
+#include "d6t-filter.h"
+#include "d6t-calib.h"
+#include "d6t-stamp.h"
+#include "d6t-phase.h"
+#include "d6t-health.h"
+#include "d6t-log.h"
+#include "d6t-rule.h"
+#include "d6t-flow.h"
 
 /* defines */
 #define D6T_ADDR 0x0A  // for I2C 7bit address
@@ -48,6 +57,8 @@
 uint8_t rbuf[N_READ];
 double ptat;
 double pix_data[N_PIXEL];
+int16_t pix_raw[N_PIXEL];
+d6t_stamp_t stamp;  // acquisition time of rbuf
 
 void delay(int msec) {
     struct timespec ts = {.tv_sec = msec / 1000,
@@ -73,11 +84,14 @@ uint32_t i2c_read_reg8(uint8_t devAddr, uint8_t regAddr,
             fprintf(stderr, "Failed to select device: %s\n", strerror(errno));
             err = 22; break;
         }
+        d6t_stamp_begin(&stamp);
         if (write(fd, &regAddr, 1) != 1) {
+            d6t_stamp_end(&stamp);  // not the stamp of the last frame.
             err = 23; break;
         }
 	delay(1); //add
         int count = read(fd, data, length);
+        d6t_stamp_end(&stamp);
         if (count < 0) {
             err = 24; break;
         } else if (count != length) {
@@ -158,34 +172,210 @@ void initialSetting(void) {
 
 /** <!-- main - Thermal sensor {{{1 -->
  * Read data
+ *
+ * options:
+ *   -f filter:   temporal filter, ema:shift, mean:frames or median:frames.
+ *   -c file:     per-pixel calibration file, applied on the conversion.
+ *   -T:          prefix the frames with the acquisition time (monotonic
+ *                midpoint of the I2C transfer) and the transfer time.
+ *   -R:          add the CLOCK_REALTIME midpoint to the timestamp.
+ *   -P:          phase-locked polling, read just after the sensor refresh
+ *                and skip the duplicated frames.
+ *   -A:          report duplicates and data age with the fixed delay.
+ *   -H:          health monitor, drop PEC-failing, out of range or stuck
+ *                frames and initialize the sensor again if they continue.
+ *   -o file:     write the output to a file by a writer thread, the
+ *                reading is not blocked by the disk.
+ *   -F msec:     longest time of the output in the buffers (default 1000).
+ *   -S sync:     durability of the file, none (default), data or full.
+ *   -a file:     alarm rule file, the raised and cleared alarms are output
+ *                as `ALARM:` lines with the frame time.
+ *   -m block:    motion vectors by block matching on the frame upsampled
+ *                to 8x8, block[,range] in pixels of 8x8 (range 1 to 3,
+ *                default 2), output as `FLOW:` lines of the block vectors
+ *                and the motion of the whole frame.
  */
-int main() {
+int main(int argc, char* argv[]) {
     int i;
 	int16_t itemp;
+	int opt;
+	static d6t_filter_t filter;
+	const char* filter_spec = NULL;
+	static d6t_calib_t calib;
+	bool calibrated = false;
+	bool stamped = false, real = false;
+	char ts[80] = "";
+	static d6t_phase_t phase;
+	bool tracked = false, locked = false;
+	static d6t_health_t health;
+	bool monitored = false;
+	static d6t_log_t logger;
+	const char* log_path = NULL;
+	const char* log_sync = NULL;
+	int log_flush = 1000;
+	FILE* out = stdout;
+	static d6t_rules_t rules;
+	bool alarmed = false;
+	char alarm[256];
+	static char line[D6T_FLOW_LINE_MAX];
+	static d6t_flow_t flow;
+	bool flowing = false;
+	int block = 0, range = 2;
+
+	while ((opt = getopt(argc, argv, "f:c:TRPAHo:F:S:a:m:")) != -1) {
+		switch (opt) {
+		case 'f': filter_spec = optarg; break;
+		case 'c':
+			if (d6t_calib_load(&calib, optarg, N_PIXEL, 10.0)) {
+				return 1;
+			}
+			calibrated = true;
+			break;
+		case 'T': stamped = true; break;
+		case 'R': stamped = real = true; break;
+		case 'P': tracked = locked = true; break;
+		case 'A': tracked = true; break;
+		case 'H': monitored = true; break;
+		case 'o': log_path = optarg; break;
+		case 'F': log_flush = atoi(optarg); break;
+		case 'S': log_sync = optarg; break;
+		case 'a':
+			if (d6t_rules_load(&rules, optarg, N_ROW, N_PIXEL, 10)) {
+				return 1;
+			}
+			alarmed = true;
+			break;
+		case 'm':
+			if (sscanf(optarg, "%d,%d", &block, &range) < 1) {
+				return 1;
+			}
+			flowing = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f filter] [-c file] [-T] [-R]"
+			        " [-P] [-A] [-H] [-o file] [-F msec] [-S sync]"
+			        " [-a file] [-m block[,range]]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (flowing && d6t_flow_init(&flow, N_ROW, 2, block, range)) {
+		return 1;
+	}
+	if (d6t_filter_init(&filter, filter_spec, N_PIXEL)) {
+		return 1;
+	}
+	if (log_path != NULL) {
+		if (d6t_log_open(&logger, log_path, log_flush, log_sync)) {
+			return 1;
+		}
+		if ((out = d6t_log_fopen(&logger)) == NULL) {
+			d6t_log_close(&logger);
+			return 1;
+		}
+		d6t_log_trap();  // close the log on SIGINT and SIGTERM.
+	}
+	d6t_health_init(&health, N_PIXEL);
+	d6t_phase_init(&phase, 300, locked);
 	
 	delay(620);	
 	
-	while(1){
+	while (!d6t_log_stopping) {
 		// Read data via I2C
 		memset(rbuf, 0, N_READ);
 		uint32_t ret = i2c_read_reg8(D6T_ADDR, D6T_CMD, rbuf, N_READ);
-		D6T_checkPEC(rbuf, N_READ - 1);
+		bool pec_err = D6T_checkPEC(rbuf, N_READ - 1);
+		if (stamped) {
+			d6t_stamp_sprint(&stamp, real, ts, sizeof(ts));
+		}
+
+		// Drop bad frames, initialize the sensor again if they continue
+		if (monitored) {
+			int state = d6t_health_check(&health, rbuf, N_READ, !pec_err,
+			                             d6t_stamp_mid(&stamp));
+			if (state == D6T_HEALTH_REINIT) {
+				fprintf(stderr, "re-initialize: %s\n", health.reason);
+				initialSetting();
+				delay(620);
+				d6t_filter_reset(&filter);
+				d6t_flow_reset(&flow);
+			} else if (state == D6T_HEALTH_RECOVERED) {
+				d6t_health_report(&health, stderr);
+				state = D6T_HEALTH_OK;
+			}
+			if (state != D6T_HEALTH_OK) {
+				d6t_phase_skip(&phase, d6t_stamp_mid(&stamp));
+				d6t_phase_wait(&phase);
+				continue;
+			}
+		}
+
+		// Track the sensor refresh, skip duplicates if phase-locked
+		if (tracked) {
+			bool fresh = d6t_phase_update(&phase, rbuf, N_READ,
+			                              d6t_stamp_mid(&stamp));
+			if ((phase.n_new + phase.n_dup) % 100 == 0) {
+				d6t_phase_report(&phase, stderr);
+			}
+			if (!fresh && locked) {
+				d6t_phase_wait(&phase);
+				continue;
+			}
+		}
 		
         //Convert to temperature data (degC)
 		ptat = (double)conv8us_s16_le(rbuf, 0) / 10.0;
+		if (calibrated) {
+			d6t_calib_decode(&calib, rbuf, pix_raw);
+		} else {
+			for (i = 0; i < N_PIXEL; i++) {
+				itemp = conv8us_s16_le(rbuf, 2 + 2*i);
+				pix_raw[i] = itemp;
+			}
+		}
+		d6t_filter_apply(&filter, pix_raw, pix_raw);
+
+		// Evaluate the alarm rules, output the raised and cleared alarms
+		if (alarmed) {
+			int k, n = d6t_rules_eval(&rules, conv8us_s16_le(rbuf, 0),
+			                          pix_raw);
+			for (k = 0; k < n; k++) {
+				if (d6t_rules_sprint(&rules, k, d6t_stamp_mid(&stamp),
+				                     alarm, sizeof(alarm)) > 0) {
+					fputs(alarm, out);
+				}
+			}
+		}
+
+		// Estimate the motion from the last frame
+		if (flowing) {
+			d6t_flow_update(&flow, pix_raw);
+			if (d6t_flow_sprint_field(&flow, line, sizeof(line)) > 0) {
+				fputs(ts, out);
+				fputs(line, out);
+			}
+			if (d6t_flow_sprint_roi(&flow, NULL, line, sizeof(line)) > 0) {
+				fputs(ts, out);
+				fputs(line, out);
+			}
+		}
 		for (i = 0; i < N_PIXEL; i++) {
-			itemp = conv8us_s16_le(rbuf, 2 + 2*i);
-			pix_data[i] = (double)itemp / 10.0;
+			pix_data[i] = (double)pix_raw[i] / 10.0;
 		}
 		
         //Output results		
-		printf("PTAT: %4.1f [degC], Temperature: ", ptat);
+		fprintf(out, "%sPTAT: %4.1f [degC], Temperature: ", ts, ptat);
 		for (i = 0; i < N_PIXEL; i++) {
-		    printf("%4.1f, ", pix_data[i]);
+		    fprintf(out, "%4.1f, ", pix_data[i]);
 		}
-		printf("[degC]\n");
+		fprintf(out, "[degC]\n");
 		
-		delay(300);
+		d6t_phase_wait(&phase);
+	}
+	if (log_path != NULL) {
+		fclose(out);
+		d6t_log_close(&logger);
+		d6t_log_report(&logger, stderr);
 	}
+	return 0;
 }
 // vi: ft=c:fdm=marker:et:sw=4:tw=80
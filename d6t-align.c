@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <string.h>
+#include "d6t-align.h"
+
+/** <!-- d6t_align_init {{{1 --> setup the queues.
+ */
+int d6t_align_init(d6t_align_t* a, int n_sensor, int64_t tolerance_ns) {
+    if (n_sensor < 1 || n_sensor > D6T_ALIGN_MAX_SENSOR || tolerance_ns < 0) {
+        return -1;
+    }
+    memset(a, 0, sizeof(*a));
+    a->n_sensor = n_sensor;
+    a->tolerance_ns = tolerance_ns;
+    return 0;
+}
+
+/** <!-- drop_head {{{1 --> remove the oldest frame of a sensor.
+ */
+static void drop_head(d6t_align_t* a, int sensor) {
+    a->q[sensor].head = (a->q[sensor].head + 1) % D6T_ALIGN_DEPTH;
+    a->q[sensor].count--;
+}
+
+/** <!-- d6t_align_push {{{1 --> queue a frame of a sensor.
+ * frames of a sensor must be pushed in the time order,
+ * the oldest frame is dropped if the queue is full.
+ * returns the number of the dropped frames.
+ */
+int d6t_align_push(d6t_align_t* a, int sensor, int64_t ts_ns, long token) {
+    int dropped = 0;
+    if (sensor < 0 || sensor >= a->n_sensor) {
+        return -1;
+    }
+    if (a->q[sensor].count >= D6T_ALIGN_DEPTH) {
+        drop_head(a, sensor);
+        a->n_dropped++;
+        dropped++;
+    }
+    int tail = (a->q[sensor].head + a->q[sensor].count) % D6T_ALIGN_DEPTH;
+    a->q[sensor].ts_ns[tail] = ts_ns;
+    a->q[sensor].token[tail] = token;
+    a->q[sensor].count++;
+    return dropped;
+}
+
+/** <!-- d6t_align_pop {{{1 --> take the next synchronized snapshot.
+ * the oldest frames of the sensors make a snapshot if they are within
+ * the tolerance, otherwise the earliest one is dropped, since a later
+ * frame of another sensor can not come closer to it.
+ * returns false until every sensor has a frame queued.
+ */
+bool d6t_align_pop(d6t_align_t* a, d6t_snapshot_t* snap) {
+    int s;
+    for (;;) {
+        int first = 0;
+        int64_t lo = INT64_MAX, hi = INT64_MIN, sum = 0;
+        for (s = 0; s < a->n_sensor; s++) {
+            if (a->q[s].count < 1) {
+                return false;
+            }
+            int64_t ts = a->q[s].ts_ns[a->q[s].head];
+            if (ts < lo) {
+                lo = ts;
+                first = s;
+            }
+            hi = ts > hi ? ts : hi;
+        }
+        if (hi - lo > a->tolerance_ns) {
+            drop_head(a, first);
+            a->n_dropped++;
+            continue;
+        }
+        for (s = 0; s < a->n_sensor; s++) {
+            sum += a->q[s].ts_ns[a->q[s].head] - lo;
+            snap->token[s] = a->q[s].token[a->q[s].head];
+            drop_head(a, s);
+        }
+        snap->ts_ns = lo + sum / a->n_sensor;
+        snap->spread_ns = (int32_t)(hi - lo);
+        a->n_snapshot++;
+        return true;
+    }
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
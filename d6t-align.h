@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_ALIGN_H_
+#define D6T_ALIGN_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* defines */
+#define D6T_ALIGN_MAX_SENSOR 8
+#define D6T_ALIGN_DEPTH 16  // queued frames per sensor
+
+/** <!-- d6t_snapshot_t {{{1 --> a frame of each sensor within tolerance.
+ * token is the value given to d6t_align_push() for the frame.
+ */
+typedef struct d6t_snapshot {
+    int64_t ts_ns;      // mean of the frame timestamps
+    int32_t spread_ns;  // latest - earliest frame timestamp
+    long token[D6T_ALIGN_MAX_SENSOR];
+} d6t_snapshot_t;
+
+/** <!-- d6t_align_t {{{1 --> frame queues of the sensors to be aligned.
+ */
+typedef struct d6t_align {
+    int n_sensor;
+    int64_t tolerance_ns;
+    long n_snapshot;
+    long n_dropped;     // frames without partners within tolerance
+    struct {
+        int head, count;
+        int64_t ts_ns[D6T_ALIGN_DEPTH];
+        long token[D6T_ALIGN_DEPTH];
+    } q[D6T_ALIGN_MAX_SENSOR];
+} d6t_align_t;
+
+int d6t_align_init(d6t_align_t* a, int n_sensor, int64_t tolerance_ns);
+int d6t_align_push(d6t_align_t* a, int sensor, int64_t ts_ns, long token);
+bool d6t_align_pop(d6t_align_t* a, d6t_snapshot_t* snap);
+
+#endif  // D6T_ALIGN_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
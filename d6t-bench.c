@@ -0,0 +1,894 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include "d6t-roi.h"
+#include "d6t-filter.h"
+#include "d6t-calib.h"
+#include "d6t-pyramid.h"
+#include "d6t-log.h"
+#include "d6t-record.h"
+#include "d6t-column.h"
+#include "d6t-rule.h"
+#include "d6t-flow.h"
+
+/* defines */
+#define BENCH_MIN_NS 200000000.0  // run each case at least 0.2 sec.
+#define BENCH_BATCH 64
+#define N_PIXEL_MAX (32 * 32)
+#define N_READ_MAX ((N_PIXEL_MAX + 1) * 2 + 1)
+
+#define BENCH_MAX_RESULT 256
+#define PIPE_MAX_FRAME 64
+
+static FILE* devnull;
+static volatile int32_t sink;
+
+/* results, also written to the result file and compared to a baseline */
+static FILE* result;
+static int n_result;
+static struct {
+    char name[48];
+    double ns;          // per frame
+    double allocs;      // per frame
+} results[BENCH_MAX_RESULT];
+
+/* heap allocations, counted by the wrappers of the linker option
+ * `-Wl,--wrap=malloc,...`. only the calls from the objects of the
+ * benchmark are counted, not the calls inside libc.
+ */
+static long n_alloc;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+int __real_posix_memalign(void** p, size_t align, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    n_alloc++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    n_alloc++;
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* p, size_t size) {
+    n_alloc++;
+    return __real_realloc(p, size);
+}
+
+int __wrap_posix_memalign(void** p, size_t align, size_t size) {
+    n_alloc++;
+    return __real_posix_memalign(p, align, size);
+}
+
+/** <!-- now_ns {{{1 --> monotonic clock in nanoseconds.
+ */
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** <!-- bench_frame {{{1 --> fill a read buffer with a synthetic frame.
+ * PTAT 27.2 degC and a slowly varying pixel pattern around 25 degC.
+ */
+static void bench_frame(uint8_t* buf, int n_pixel, int seed) {
+    int i;
+    buf[0] = 272 & 0xFF;
+    buf[1] = 272 >> 8;
+    for (i = 0; i < n_pixel; i++) {
+        int16_t v = (int16_t)(250 + (i * 7 + seed) % 20);
+        buf[2 + 2 * i] = (uint8_t)(v & 0xFF);
+        buf[3 + 2 * i] = (uint8_t)((uint16_t)v >> 8);
+    }
+}
+
+/** <!-- bench_report {{{1 --> print a result line.
+ * the result file has a tab separated line of name, frames/s, ns/frame,
+ * ns/pixel and allocations/frame for each case.
+ */
+static void bench_report(const char* name, int n_pixel,
+                         long n_iter, double ns, long allocs) {
+    double per_frame = ns / n_iter;
+    double alloc_frame = (double)allocs / n_iter;
+    printf("%-28s %10.1f ns/frame %8.2f ns/pixel %10.0f frames/s"
+           " %6.2f allocs/frame\n", name, per_frame, per_frame / n_pixel,
+           1e9 / per_frame, alloc_frame);
+    if (result != NULL) {
+        fprintf(result, "%s\t%.1f\t%.1f\t%.3f\t%.3f\n", name,
+                1e9 / per_frame, per_frame, per_frame / n_pixel, alloc_frame);
+    }
+    if (n_result < BENCH_MAX_RESULT) {
+        snprintf(results[n_result].name, sizeof(results[0].name), "%s", name);
+        results[n_result].ns = per_frame;
+        results[n_result].allocs = alloc_frame;
+        n_result++;
+    }
+}
+
+/* benchmark macro, runs `body` until BENCH_MIN_NS has elapsed. */
+#define BENCH_RUN(name, n_pixel, body) do { \
+        long n_iter_ = 0, n_alloc_ = n_alloc; \
+        double t0_ = now_ns(), t1_; \
+        do { \
+            int b_; \
+            for (b_ = 0; b_ < BENCH_BATCH; b_++) {body;} \
+            n_iter_ += BENCH_BATCH; \
+        } while ((t1_ = now_ns()) - t0_ < BENCH_MIN_NS); \
+        bench_report(name, n_pixel, n_iter_, t1_ - t0_, \
+                     n_alloc - n_alloc_); \
+    } while (false)
+
+/** <!-- bench_roi {{{1 --> decode and output cost against the ROI size.
+ * `full` is the d6t-32l path (all pixels, double conversion, printf),
+ * `roi NxN decode` converts the ROI pixels only,
+ * `roi NxN output` also formats the pixel line and writes it out.
+ */
+static void bench_roi(void) {
+    static uint8_t rbuf[N_READ_MAX];
+    static double pix_data[N_PIXEL_MAX];
+    static int16_t vals[N_PIXEL_MAX];
+    static char line[10240];
+    static d6t_roi_t roi;
+    static const int sizes[] = {1, 4, 8, 16, 32};
+    char name[64], spec[64];
+    size_t k;
+    int i;
+
+    bench_frame(rbuf, N_PIXEL_MAX, 0);
+    BENCH_RUN("roi full 32x32 output", N_PIXEL_MAX, {
+        fprintf(devnull, "PTAT: %4.1f [degC], Temperature: ",
+                (double)(int16_t)(rbuf[0] | rbuf[1] << 8) / 10.0);
+        for (i = 0; i < N_PIXEL_MAX; i++) {
+            int16_t itemp = (int16_t)(rbuf[2 + 2 * i] | rbuf[3 + 2 * i] << 8);
+            pix_data[i] = (double)itemp / 10.0;
+        }
+        for (i = 0; i < N_PIXEL_MAX; i++) {
+            fprintf(devnull, "%4.1f, ", pix_data[i]);
+        }
+        fprintf(devnull, "[degC]\n");
+    });
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        int n = sizes[k];
+        snprintf(spec, sizeof(spec), "b=0,0,%d,%d", n, n);
+        d6t_roi_parse(&roi, spec, 32);
+        snprintf(name, sizeof(name), "roi %dx%d decode", n, n);
+        BENCH_RUN(name, roi.n, {
+            d6t_roi_decode(&roi, rbuf, vals);
+            sink += vals[b_ % roi.n];
+        });
+        snprintf(name, sizeof(name), "roi %dx%d output", n, n);
+        BENCH_RUN(name, roi.n, {
+            d6t_roi_decode(&roi, rbuf, vals);
+            int len = d6t_roi_sprint(&roi, 272, vals, false,
+                                     line, sizeof(line));
+            fwrite(line, 1, len, devnull);
+        });
+        snprintf(name, sizeof(name), "roi %dx%d summary", n, n);
+        BENCH_RUN(name, roi.n, {
+            d6t_roi_decode(&roi, rbuf, vals);
+            int len = d6t_roi_sprint(&roi, 272, vals, true,
+                                     line, sizeof(line));
+            fwrite(line, 1, len, devnull);
+        });
+    }
+}
+
+/* model sizes, shared by the per-model benchmarks */
+static const struct {
+    const char* name;
+    int n_pixel;
+    double scale;       // raw units per degC of the pixels
+} models[] = {
+    {"1a", 1, 10.0}, {"8l", 8, 10.0}, {"8lh", 8, 5.0}, {"44l", 16, 10.0},
+    {"32l", 32 * 32, 10.0},
+};
+#define N_MODELS ((int)(sizeof(models) / sizeof(models[0])))
+
+/** <!-- bench_filter {{{1 --> temporal filter cost per frame and model.
+ */
+static void bench_filter(void) {
+    static d6t_filter_t filter;
+    static int16_t in[2][N_PIXEL_MAX], out[N_PIXEL_MAX];
+    static const char* specs[] = {"ema:2", "mean:8", "median:3", "median:5"};
+    char name[64];
+    size_t k;
+    int m, i;
+
+    for (i = 0; i < N_PIXEL_MAX; i++) {
+        in[0][i] = (int16_t)(250 + i % 20);
+        in[1][i] = (int16_t)(250 + (i * 3) % 20);
+    }
+    for (m = 0; m < N_MODELS; m++) {
+        for (k = 0; k < sizeof(specs) / sizeof(specs[0]); k++) {
+            d6t_filter_init(&filter, specs[k], models[m].n_pixel);
+            snprintf(name, sizeof(name), "filter %s %s",
+                     models[m].name, specs[k]);
+            BENCH_RUN(name, models[m].n_pixel, {
+                d6t_filter_apply(&filter, in[b_ & 1], out);
+                sink += out[0];
+            });
+        }
+    }
+}
+
+/** <!-- bench_calib {{{1 --> calibrated and raw conversion side by side.
+ * `raw` is the conversion loop of the samples,
+ * `calib` the fused conversion and calibration of d6t_calib_decode(),
+ * `calib 2-pass` converts first and calibrates on a second traversal.
+ */
+static void bench_calib(void) {
+    static d6t_calib_t calib;
+    static uint8_t rbuf[N_READ_MAX];
+    static int16_t out[N_PIXEL_MAX];
+    char name[64];
+    int m, i;
+
+    bench_frame(rbuf, N_PIXEL_MAX, 0);
+    for (m = 0; m < N_MODELS; m++) {
+        int n = models[m].n_pixel;
+        calib.n = n;
+        calib.ptat_ref = 250;
+        for (i = 0; i < n; i++) {
+            calib.gain[i] = (1 << D6T_CALIB_Q) + i % 64;
+            calib.ptat_coef[i] = i % 16;
+            calib.offset[i] = i % 5 - 2;
+        }
+        snprintf(name, sizeof(name), "decode %s raw", models[m].name);
+        BENCH_RUN(name, n, {
+            for (i = 0; i < n; i++) {
+                out[i] = (int16_t)(rbuf[2 + 2 * i] | rbuf[3 + 2 * i] << 8);
+            }
+            sink += out[b_ % n];
+        });
+        snprintf(name, sizeof(name), "decode %s calib", models[m].name);
+        BENCH_RUN(name, n, {
+            d6t_calib_decode(&calib, rbuf, out);
+            sink += out[b_ % n];
+        });
+        snprintf(name, sizeof(name), "decode %s calib 2-pass",
+                 models[m].name);
+        BENCH_RUN(name, n, {
+            int16_t dp = (int16_t)((int16_t)(rbuf[0] | rbuf[1] << 8) -
+                                   calib.ptat_ref);  // in range here.
+            for (i = 0; i < n; i++) {
+                out[i] = (int16_t)(rbuf[2 + 2 * i] | rbuf[3 + 2 * i] << 8);
+            }
+            for (i = 0; i < n; i++) {
+                int32_t v = out[i] * calib.gain[i] + dp * calib.ptat_coef[i] +
+                            (1 << (D6T_CALIB_Q - 1));
+                v = (v >> D6T_CALIB_Q) + calib.offset[i];
+                v = v < INT16_MIN ? INT16_MIN : v;
+                out[i] = (int16_t)(v > INT16_MAX ? INT16_MAX : v);
+            }
+            sink += out[b_ % n];
+        });
+    }
+}
+
+/** <!-- pyramid_direct {{{1 --> decimate a 32x32 frame to one level directly.
+ * the loop of a consumer doing its own decimation, for the comparison.
+ */
+static void pyramid_direct(const int16_t* pix, int rows, bool max,
+                           int16_t* out) {
+    int x, y, i, j;
+    int b = 32 / rows;
+    for (y = 0; y < rows; y++) {
+        for (x = 0; x < rows; x++) {
+            int32_t acc = max ? INT16_MIN : 0;
+            for (j = 0; j < b; j++) {
+                const int16_t* src = pix + (y * b + j) * 32 + x * b;
+                for (i = 0; i < b; i++) {
+                    acc = max ? (src[i] > acc ? src[i] : acc) : acc + src[i];
+                }
+            }
+            out[y * rows + x] = (int16_t)(max ? acc :
+                                          (acc + b * b / 2) / (b * b));
+        }
+    }
+}
+
+/** <!-- bench_pyramid {{{1 --> decimation cost per level of a 32x32 frame.
+ * `pyramid box 16..N` builds the levels down to NxN in one pass,
+ * `direct NxN` decimates the full frame to a level by its own loop,
+ * `direct all` is three consumers decimating to 16, 8 and 4 rows.
+ */
+static void bench_pyramid(void) {
+    static d6t_pyramid_t pyramid;
+    static int16_t pix[N_PIXEL_MAX], out[N_PIXEL_MAX];
+    static const char* pools[] = {"box", "max"};
+    static const int rows[] = {16, 8, 4};
+    char name[64];
+    size_t k, l;
+    int i;
+
+    for (i = 0; i < N_PIXEL_MAX; i++) {
+        pix[i] = (int16_t)(250 + (i * 7) % 20);
+    }
+    for (k = 0; k < sizeof(pools) / sizeof(pools[0]); k++) {
+        bool max = k == 1;
+        d6t_pyramid_init(&pyramid, 32, pools[k]);
+        for (l = 0; l < sizeof(rows) / sizeof(rows[0]); l++) {
+            d6t_pyramid_request(&pyramid, rows[l]);
+            snprintf(name, sizeof(name), "pyramid %s 16..%d",
+                     pools[k], rows[l]);
+            BENCH_RUN(name, N_PIXEL_MAX, {
+                pix[b_ & 63] ^= 1;  // keep the frame changing.
+                d6t_pyramid_build(&pyramid, pix);
+                sink += pyramid.lvl[l][0];
+            });
+        }
+        for (l = 0; l < sizeof(rows) / sizeof(rows[0]); l++) {
+            snprintf(name, sizeof(name), "pyramid %s direct %dx%d",
+                     pools[k], rows[l], rows[l]);
+            BENCH_RUN(name, N_PIXEL_MAX, {
+                pix[b_ & 63] ^= 1;
+                pyramid_direct(pix, rows[l], max, out);
+                sink += out[0];
+            });
+        }
+        snprintf(name, sizeof(name), "pyramid %s direct all", pools[k]);
+        BENCH_RUN(name, N_PIXEL_MAX, {
+            pix[b_ & 63] ^= 1;
+            for (l = 0; l < sizeof(rows) / sizeof(rows[0]); l++) {
+                pyramid_direct(pix, rows[l], max, out);
+                sink += out[0];
+            }
+        });
+    }
+}
+
+/** <!-- bench_log {{{1 --> cost of a 32x32 frame output to a file.
+ * `stdio` is the output redirected to a file and flushed every frame,
+ * `sink` appends the frame to the buffers of d6t-log.c.
+ * the files are in the current directory, to be on the target disk.
+ */
+static void bench_log(void) {
+    static d6t_log_t logger;
+    static char line[10240];
+    static const char* syncs[] = {"none", "data"};
+    const char* path = "d6t-bench.log";
+    char name[64];
+    size_t k;
+    int i, n = 0;
+
+    n += snprintf(line, sizeof(line), "PTAT: 27.2 [degC], Temperature: ");
+    for (i = 0; i < N_PIXEL_MAX; i++) {
+        n += snprintf(line + n, sizeof(line) - n, "%4.1f, ",
+                      (250 + i % 20) / 10.0);
+    }
+    n += snprintf(line + n, sizeof(line) - n, "[degC]\n");
+
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        return;
+    }
+    BENCH_RUN("log 32l stdio", N_PIXEL_MAX, {
+        fwrite(line, 1, n, fp);
+        fflush(fp);
+    });
+    fclose(fp);
+    for (k = 0; k < sizeof(syncs) / sizeof(syncs[0]); k++) {
+        unlink(path);
+        if (d6t_log_open(&logger, path, 100, syncs[k])) {
+            return;
+        }
+        snprintf(name, sizeof(name), "log 32l sink %s", syncs[k]);
+        BENCH_RUN(name, N_PIXEL_MAX, {
+            d6t_log_write(&logger, line, n);
+        });
+        d6t_log_close(&logger);
+        d6t_log_report(&logger, stdout);
+    }
+    unlink(path);
+}
+
+/* recorded frames for the pipeline benchmark */
+static d6t_record_t recording[PIPE_MAX_FRAME];
+static int n_recording;
+
+/** <!-- load_recording {{{1 --> read frames recorded by the samples.
+ * text output or binary records (d6t-replay -b), the first frames only.
+ */
+static int load_recording(const char* path) {
+    static char line[D6T_RECORD_LINE_MAX + 80];
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        return -1;
+    }
+    while (n_recording < PIPE_MAX_FRAME &&
+           d6t_record_next(&recording[n_recording], fp, line,
+                           sizeof(line)) > 0) {
+        n_recording++;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/** <!-- pipe_crc {{{1 --> PEC of the samples, CRC-8 bit by bit.
+ */
+static uint8_t pipe_crc(uint8_t data) {
+    int index;
+    uint8_t temp;
+    for (index = 0; index < 8; index++) {
+        temp = data;
+        data <<= 1;
+        if (temp & 0x80) {data ^= 0x07;}
+    }
+    return data;
+}
+
+static uint8_t pipe_pec(const uint8_t* buf, int n) {
+    int i;
+    uint8_t crc = pipe_crc((0x0A << 1) | 1);  // I2C Read address (8bit)
+    for (i = 0; i < n; i++) {
+        crc = pipe_crc(buf[i] ^ crc);
+    }
+    return crc;
+}
+
+/** <!-- bench_pipeline {{{1 --> whole processing of a frame per model.
+ * PEC, decode, temporal filter, min/max/mean, formatting and output as
+ * in the samples, `stdio` outputs to /dev/null by stdio and `log` by the
+ * buffers of d6t-log.c. the frames are synthetic, or recorded frames
+ * if they are given by `-r`. a recording does not tell D6T-8L from
+ * D6T-8LH, its frames are used by the first model of the pixel number
+ * and converted from 0.1 degC to the raw units of the model.
+ */
+static void bench_pipeline(void) {
+    static uint8_t frames[PIPE_MAX_FRAME][N_READ_MAX];
+    static int16_t raw[N_PIXEL_MAX];
+    static double pix_data[N_PIXEL_MAX];
+    static d6t_filter_t filter;
+    static d6t_log_t logger;
+    char name[64];
+    int m, i, k, s;
+
+    for (m = 0; m < N_MODELS; m++) {
+        int n = models[m].n_pixel;
+        int n_read = (n + 1) * 2 + 1;
+        int n_frame = 0;
+        bool first = true;
+        for (i = 0; i < m; i++) {
+            first = first && models[i].n_pixel != n;
+        }
+        for (k = 0; k < n_recording && first; k++) {
+            d6t_record_t* r = &recording[k];
+            if (r->n_pixel != n) {
+                continue;
+            }
+            uint8_t* buf = frames[n_frame++];
+            buf[0] = (uint8_t)(r->ptat & 0xFF);
+            buf[1] = (uint8_t)((uint16_t)r->ptat >> 8);
+            for (i = 0; i < n; i++) {
+                double v = r->pix[i] * models[m].scale / 10.0;
+                v = v < INT16_MIN ? INT16_MIN : v > INT16_MAX ? INT16_MAX : v;
+                int16_t itemp = (int16_t)v;
+                buf[2 + 2 * i] = (uint8_t)(itemp & 0xFF);
+                buf[3 + 2 * i] = (uint8_t)((uint16_t)itemp >> 8);
+            }
+        }
+        for (; n_frame < 16; n_frame++) {
+            bench_frame(frames[n_frame], n, n_frame);
+        }
+        for (k = 0; k < n_frame; k++) {
+            frames[k][n_read - 1] = pipe_pec(frames[k], n_read - 1);
+        }
+
+        for (s = 0; s < 2; s++) {
+            FILE* out = devnull;
+            if (s == 1 && d6t_log_open(&logger, "/dev/null", 1000, NULL)) {
+                return;
+            }
+            if (s == 1 && (out = d6t_log_fopen(&logger)) == NULL) {
+                d6t_log_close(&logger);
+                return;
+            }
+            d6t_filter_init(&filter, "ema:2", n);
+            snprintf(name, sizeof(name), "pipeline %s %s", models[m].name,
+                     s == 1 ? "log" : "stdio");
+            BENCH_RUN(name, n, {
+                const uint8_t* buf = frames[b_ % n_frame];
+                if (pipe_pec(buf, n_read - 1) != buf[n_read - 1]) {
+                    continue;
+                }
+                double ptat = (double)(int16_t)(buf[0] | buf[1] << 8) / 10.0;
+                for (i = 0; i < n; i++) {
+                    raw[i] = (int16_t)(buf[2 + 2 * i] | buf[3 + 2 * i] << 8);
+                }
+                d6t_filter_apply(&filter, raw, raw);
+                int32_t lo = raw[0];  // no comma, a macro argument.
+                int32_t hi = raw[0];
+                int32_t sum = 0;
+                for (i = 0; i < n; i++) {
+                    lo = raw[i] < lo ? raw[i] : lo;
+                    hi = raw[i] > hi ? raw[i] : hi;
+                    sum += raw[i];
+                    pix_data[i] = (double)raw[i] / models[m].scale;
+                }
+                sink += lo + hi + sum / n;
+                fprintf(out, "PTAT: %4.1f [degC], Temperature: ", ptat);
+                for (i = 0; i < n; i++) {
+                    fprintf(out, "%4.1f, ", pix_data[i]);
+                }
+                fprintf(out, "[degC]\n");
+            });
+            if (s == 1) {
+                fclose(out);
+                d6t_log_close(&logger);
+            }
+        }
+    }
+}
+
+/** <!-- bench_column {{{1 --> loading a frame from a log, text or columns.
+ * `parse` reads a text line of the samples back to raw values,
+ * `append` transposes a frame to the columns of the export.
+ */
+static void bench_column(void) {
+    static d6t_column_writer_t writer;
+    static d6t_record_t r;
+    static char line[D6T_RECORD_LINE_MAX];
+    char name[64];
+    int m, i;
+
+    for (m = 0; m < N_MODELS; m++) {
+        int n = models[m].n_pixel;
+        r.n_pixel = (uint16_t)n;
+        r.ptat = 272;
+        for (i = 0; i < n; i++) {
+            r.pix[i] = (int16_t)(250 + (i * 7) % 20);
+        }
+        d6t_record_sprint(&r, line, sizeof(line));
+        snprintf(name, sizeof(name), "column %s text parse", models[m].name);
+        BENCH_RUN(name, n, {
+            d6t_record_parse(&r, line);
+            sink += r.pix[b_ % n];
+        });
+        if (d6t_column_create(&writer, "/dev/null", n, 1024)) {
+            return;
+        }
+        snprintf(name, sizeof(name), "column %s append", models[m].name);
+        BENCH_RUN(name, n, {
+            d6t_column_append(&writer, &r);
+        });
+        d6t_column_close(&writer);
+    }
+}
+
+/** <!-- rules_naive {{{1 --> one rule evaluated by its own zone pass.
+ * the straightforward evaluator to compare with, returns the condition.
+ */
+static int rules_naive(const d6t_roi_t* zone, int op, int16_t ptat,
+                       const int16_t* pix, int32_t thr) {
+    int32_t v = op == 0 ? INT16_MAX : op == 1 ? INT16_MIN : 0;
+    int i;
+
+    for (i = 0; i < zone->n; i++) {
+        int16_t p = pix[zone->idx[i]];
+        if (op == 0) {
+            v = p < v ? p : v;
+        } else if (op == 1) {
+            v = p > v ? p : v;
+        } else {
+            v += p;
+        }
+    }
+    if (op == 2) {
+        v /= zone->n;
+    }
+    return v - ptat > thr;
+}
+
+/** <!-- bench_rules {{{1 --> compiled alarm rules against the rule count.
+ * `naive` walks the zone of every rule with a branchy evaluation,
+ * `compiled` is d6t_rules_eval (zone statistics once, then the plan).
+ */
+static void bench_rules(void) {
+    static d6t_rules_t rs;
+    static d6t_roi_t zone[16];
+    static int16_t pix[N_PIXEL_MAX];
+    static const int counts[] = {100, 500, 1000};
+    static const char* const ops[] = {"min", "max", "mean"};
+    char path[64], name[64];
+    int c, i, z, fd;
+
+    for (i = 0; i < N_PIXEL_MAX; i++) {
+        pix[i] = (int16_t)(250 + (i * 7) % 20);
+    }
+    for (z = 0; z < 16; z++) {  // 4x4 grid of 8x8 zones.
+        snprintf(name, sizeof(name), "z%d=%d,%d,8,8", z, z % 4 * 8, z / 4 * 8);
+        d6t_roi_parse(&zone[z], name, 32);
+    }
+    for (c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); c++) {
+        int n = counts[c];
+        FILE* fp;
+        snprintf(path, sizeof(path), "/tmp/d6t-bench-rules-XXXXXX");
+        if ((fd = mkstemp(path)) < 0 || (fp = fdopen(fd, "w")) == NULL) {
+            return;
+        }
+        for (z = 0; z < 16; z++) {
+            fprintf(fp, "zone z%d %d,%d,8,8\n", z, z % 4 * 8, z / 4 * 8);
+        }
+        for (i = 0; i < n; i++) {
+            fprintf(fp, "rule r%d %s(z%d) - ptat > %d.%d\n", i, ops[i % 3],
+                    i % 16, i % 5, i % 10);
+        }
+        fclose(fp);
+        i = d6t_rules_load(&rs, path, 32, N_PIXEL_MAX, 10);
+        unlink(path);
+        if (i) {
+            return;
+        }
+        snprintf(name, sizeof(name), "rules %d naive", n);
+        BENCH_RUN(name, N_PIXEL_MAX, {
+            for (i = 0; i < n; i++) {
+                sink += rules_naive(&zone[i % 16], i % 3, 10, pix,
+                                    i % 5 * 10 + i % 10);
+            }
+        });
+        snprintf(name, sizeof(name), "rules %d compiled", n);
+        BENCH_RUN(name, N_PIXEL_MAX, {
+            pix[b_] ^= 1;  // keep the frames changing.
+            sink += d6t_rules_eval(&rs, 10, pix);
+        });
+    }
+}
+
+/** <!-- flow_direct {{{1 --> block matching by a pass per block and shift.
+ * the straightforward search to compare with, clamped at the edges,
+ * returns the sum of the best shifts.
+ */
+static int flow_direct(const int16_t* cur, const int16_t* prev, int n_row,
+                       int block, int range) {
+    int bx, by, dx, dy, x, y, ret = 0;
+
+    for (by = 0; by < n_row; by += block) {
+        for (bx = 0; bx < n_row; bx += block) {
+            int32_t best = INT32_MAX;
+            int shift = 0;
+            for (dy = -range; dy <= range; dy++) {
+                for (dx = -range; dx <= range; dx++) {
+                    int32_t sad = 0;
+                    for (y = by; y < by + block; y++) {
+                        for (x = bx; x < bx + block; x++) {
+                            int py = y + dy < 0 ? 0 : y + dy >= n_row ?
+                                     n_row - 1 : y + dy;
+                            int px = x + dx < 0 ? 0 : x + dx >= n_row ?
+                                     n_row - 1 : x + dx;
+                            sad += abs(cur[y * n_row + x] -
+                                       prev[py * n_row + px]);
+                        }
+                    }
+                    if (sad < best) {
+                        best = sad;
+                        shift = dy * 8 + dx;
+                    }
+                }
+            }
+            ret += shift;
+        }
+    }
+    return ret;
+}
+
+/** <!-- bench_flow {{{1 --> motion vectors against the block size.
+ * a warm spot moves a pixel per frame, `direct` is a plain search per
+ * block and shift, `flow` is d6t_flow_update with the field and a
+ * region output formatted.
+ */
+static void bench_flow(void) {
+    static d6t_flow_t flow;
+    static int16_t frame[2][N_PIXEL_MAX];
+    static int16_t up[2][N_PIXEL_MAX];
+    static char line[D6T_FLOW_LINE_MAX];
+    static const struct {
+        const char* name;
+        int n_row, up, block, range;
+    } cases[] = {
+        {"32l 4x4 +-2", 32, 1, 4, 2},
+        {"32l 8x8 +-2", 32, 1, 8, 2},
+        {"32l 4x4 +-3", 32, 1, 4, 3},
+        {"44l 2x2 +-2", 4, 2, 2, 2},
+    };
+    char name[64];
+    int c, i, t;
+
+    for (c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++) {
+        int n = cases[c].n_row, m = n * cases[c].up;
+        for (t = 0; t < 2; t++) {
+            for (i = 0; i < n * n; i++) {
+                int dx = i % n - n / 2 - t, dy = i / n - n / 2;
+                frame[t][i] = (int16_t)(250 + (dx * dx + dy * dy < 16 ?
+                                               100 : 0) + (i * 7) % 5);
+            }
+            if (cases[c].up == 2) {
+                d6t_flow_upsample(frame[t], n, up[t]);
+            } else {
+                memcpy(up[t], frame[t], n * n * sizeof(int16_t));
+            }
+        }
+        snprintf(name, sizeof(name), "flow %s direct", cases[c].name);
+        BENCH_RUN(name, n * n, {
+            sink += flow_direct(up[b_ & 1], up[~b_ & 1], m,
+                                cases[c].block, cases[c].range);
+        });
+        if (d6t_flow_init(&flow, n, cases[c].up, cases[c].block,
+                          cases[c].range)) {
+            return;
+        }
+        snprintf(name, sizeof(name), "flow %s", cases[c].name);
+        BENCH_RUN(name, n * n, {
+            sink += d6t_flow_update(&flow, frame[b_ & 1]);
+        });
+        snprintf(name, sizeof(name), "flow %s output", cases[c].name);
+        BENCH_RUN(name, n * n, {
+            sink += d6t_flow_update(&flow, frame[b_ & 1]);
+            sink += d6t_flow_sprint_field(&flow, line, sizeof(line));
+            sink += d6t_flow_sprint_roi(&flow, NULL, line, sizeof(line));
+        });
+    }
+}
+
+/** <!-- compare_baseline {{{1 --> compare the results to a result file.
+ * a case is a regression if its time per frame is longer than the
+ * threshold (in percent), or if it allocates more per frame.
+ * a missing file is no baseline yet, nothing is compared.
+ * returns the number of the regressions, or -1 if the file is not read.
+ */
+static int compare_baseline(const char* path, double threshold) {
+    char line[256];
+    int n_regress = 0, n_compared = 0, r;
+    FILE* fp = fopen(path, "r");
+
+    if (fp == NULL && errno == ENOENT) {
+        printf("no baseline %s, not compared\n", path);
+        return 0;
+    }
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char* tab = strchr(line, '\t');
+        double fps, ns, ns_pixel, allocs;
+        if (tab == NULL || sscanf(tab + 1, "%lf %lf %lf %lf",
+                                  &fps, &ns, &ns_pixel, &allocs) != 4) {
+            continue;
+        }
+        *tab = '\0';
+        for (r = 0; r < n_result; r++) {
+            if (strcmp(results[r].name, line) != 0) {
+                continue;
+            }
+            double diff = 100.0 * (results[r].ns - ns) / ns;
+            bool slow = diff > threshold;
+            bool alloc = results[r].allocs > allocs + 0.005;
+            if (slow || alloc) {
+                printf("REGRESSION %-28s %10.1f -> %10.1f ns/frame (%+.1f%%)"
+                       " %6.2f -> %6.2f allocs/frame\n", line, ns,
+                       results[r].ns, diff, allocs, results[r].allocs);
+                n_regress++;
+            }
+            n_compared++;
+        }
+    }
+    fclose(fp);
+    printf("compared %d cases with %s, %d regressions over %.1f%%\n",
+           n_compared, path, n_regress, threshold);
+    return n_regress;
+}
+
+/* benchmark table */
+static const struct {
+    const char* name;
+    void (*func)(void);
+} benches[] = {
+    {"roi", bench_roi},
+    {"filter", bench_filter},
+    {"calib", bench_calib},
+    {"pyramid", bench_pyramid},
+    {"log", bench_log},
+    {"pipeline", bench_pipeline},
+    {"column", bench_column},
+    {"rules", bench_rules},
+    {"flow", bench_flow},
+};
+
+/** <!-- main - benchmarks {{{1 -->
+ * run all benchmarks, or the benchmarks named in the arguments.
+ *
+ * options:
+ *   -o file:     write the results to a file, tab separated.
+ *   -b file:     compare the results to a result file of a former run,
+ *                exit with 2 if a case regressed, a missing file is
+ *                not compared.
+ *   -t percent:  regression threshold of the time per frame (default 10).
+ *   -r file:     recorded frames (text or binary) for the pipeline.
+ */
+int main(int argc, char* argv[]) {
+    size_t k;
+    int j, opt, ret = 0;
+    const char* baseline = NULL;
+    double threshold = 10.0;
+
+    while ((opt = getopt(argc, argv, "o:b:t:r:")) != -1) {
+        switch (opt) {
+        case 'o':
+            if ((result = fopen(optarg, "w")) == NULL) {
+                fprintf(stderr, "Failed to open: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'b': baseline = optarg; break;
+        case 't': threshold = atof(optarg); break;
+        case 'r':
+            if (load_recording(optarg)) {
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-o file] [-b file] [-t percent]"
+                    " [-r file] [bench ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    devnull = fopen("/dev/null", "w");
+    if (devnull == NULL) {
+        fprintf(stderr, "Failed to open /dev/null\n");
+        return 1;
+    }
+    for (k = 0; k < sizeof(benches) / sizeof(benches[0]); k++) {
+        bool run = optind >= argc;
+        for (j = optind; j < argc; j++) {
+            run = run || strcmp(argv[j], benches[k].name) == 0;
+        }
+        if (run) {
+            benches[k].func();
+        }
+    }
+    fclose(devnull);
+    if (result != NULL) {
+        fclose(result);
+    }
+    if (baseline != NULL) {
+        int n_regress = compare_baseline(baseline, threshold);
+        ret = n_regress > 0 ? 2 : n_regress < 0 ? 1 : 0;
+    }
+    return ret;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "d6t.hpp"
+
+/* defines */
+#define BENCH_MIN_NS 200000000.0  // run each case at least 0.2 sec.
+#define BENCH_BATCH 64
+
+static volatile int32_t sink;
+
+/** <!-- now_ns {{{1 --> monotonic clock in nanoseconds.
+ */
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** <!-- bench_run {{{1 --> run body until BENCH_MIN_NS and print a line.
+ */
+template <class F> static void bench_run(const char* name, int n_pixel,
+                                         F body) {
+    long n_iter = 0;
+    double t0 = now_ns(), t1;
+    do {
+        for (int b = 0; b < BENCH_BATCH; b++) {
+            body();
+        }
+        n_iter += BENCH_BATCH;
+    } while ((t1 = now_ns()) - t0 < BENCH_MIN_NS);
+    double per_frame = (t1 - t0) / n_iter;
+    printf("%-28s %10.1f ns/frame %8.2f ns/pixel %10.0f frames/s\n",
+           name, per_frame, per_frame / n_pixel, 1e9 / per_frame);
+}
+
+/* runtime path, the loops of the C samples with a runtime pixel count {{{1 */
+static volatile int n_runtime;  // the pixel count, not known to the compiler
+
+static bool rt_pec_ok(const uint8_t* buf, int n) {
+    // the PEC table of d6t.hpp, to compare the loops only.
+    uint8_t crc = d6t::crc_table[(d6t::kAddr << 1) | 1];
+    for (int i = 0; i < n; i++) {
+        crc = d6t::crc_table[buf[i] ^ crc];
+    }
+    return crc == buf[n];
+}
+
+static void rt_decode(const uint8_t* buf, int n_pixel, int16_t* pix) {
+    for (int i = 0; i < n_pixel; i++) {
+        pix[i] = d6t::to_s16(buf + 2 + 2 * i);
+    }
+}
+
+static d6t::Stats rt_stats(const int16_t* pix, int n_pixel) {
+    d6t::Stats s = {pix[0], pix[0], 0, 0};
+    for (int i = 0; i < n_pixel; i++) {
+        if (pix[i] < s.min) {s.min = pix[i];}
+        if (pix[i] > s.max) {s.max = pix[i]; s.argmax = i;}
+        s.sum += pix[i];
+    }
+    return s;
+}
+
+/** <!-- bench_model {{{1 --> PEC, decode and statistics of a model.
+ */
+template <class M> static void bench_model() {
+    static d6t::ReadBuffer<M> buf;
+    static d6t::Frame<M> frame;
+    static int16_t pix[d6t::n_pixel<M>];
+    constexpr int n = d6t::n_pixel<M>;
+    char name[64];
+
+    buf[0] = 272 & 0xFF;
+    buf[1] = 272 >> 8;
+    for (int i = 0; i < n; i++) {
+        int16_t v = (int16_t)(250 + (i * 7) % 20);
+        buf[2 + 2 * i] = (uint8_t)(v & 0xFF);
+        buf[3 + 2 * i] = (uint8_t)((uint16_t)v >> 8);
+    }
+    uint8_t crc = d6t::crc_table[(d6t::kAddr << 1) | 1];
+    for (int i = 0; i < d6t::n_read<M> - 1; i++) {
+        crc = d6t::crc_table[buf[i] ^ crc];
+    }
+    buf[d6t::n_read<M> - 1] = crc;
+
+    n_runtime = n;
+    const int n_rt = n_runtime;
+    snprintf(name, sizeof(name), "%s runtime", M::name);
+    bench_run(name, n, [&] {
+        bool ok = rt_pec_ok(buf.data(), (n_rt + 1) * 2);
+        rt_decode(buf.data(), n_rt, pix);
+        sink += rt_stats(pix, n_rt).sum + ok;
+    });
+    snprintf(name, sizeof(name), "%s template", M::name);
+    bench_run(name, n, [&] {
+        bool ok = d6t::pec_ok<M>(buf);
+        d6t::decode<M>(buf, &frame);
+        sink += d6t::stats<M>(frame).sum + ok;
+    });
+}
+
+/** <!-- main - C++ API benchmarks {{{1 -->
+ * PEC, decode and statistics of the header-only API against the
+ * runtime path of the C samples, for each model.
+ */
+int main() {
+    bench_model<d6t::D6T_1A>();
+    bench_model<d6t::D6T_8L>();
+    bench_model<d6t::D6T_8LH>();
+    bench_model<d6t::D6T_44L>();
+    bench_model<d6t::D6T_32L>();
+    return 0;
+}
+// vi: ft=cpp:fdm=marker:et:sw=4:tw=80
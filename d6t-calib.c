@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "d6t-calib.h"
+
+/** <!-- round_i32 {{{1 --> round to the nearest integer.
+ */
+static int32_t round_i32(double v) {
+    return (int32_t)(v >= 0 ? v + 0.5 : v - 0.5);
+}
+
+/** <!-- to_q {{{1 --> convert a factor to Q14, rounded and saturated.
+ */
+static int16_t to_q(double v) {
+    int32_t q = round_i32(v * (double)(1 << D6T_CALIB_Q));
+    return (int16_t)(q > INT16_MAX ? INT16_MAX : q < INT16_MIN ? INT16_MIN : q);
+}
+
+/** <!-- calib_dp {{{1 --> PTAT difference from the reference, saturated.
+ * with |dp| < 2^15 the Q14 sum of a pixel stays in int32 for any raw
+ * value, gain and coefficient, and the products stay 16 x 16 bit.
+ */
+static int16_t calib_dp(const d6t_calib_t* c, const uint8_t* buf) {
+    int32_t ptat = (int16_t)((uint16_t)buf[0] | ((uint16_t)buf[1] << 8));
+    int32_t dp = ptat - c->ptat_ref;
+    return (int16_t)(dp > INT16_MAX ? INT16_MAX :
+                     dp < -INT16_MAX ? -INT16_MAX : dp);
+}
+
+/** <!-- calib_pixel {{{1 --> correct a pixel, saturated to int16.
+ */
+static inline int16_t calib_pixel(int16_t raw, int16_t gain, int16_t dp,
+                                  int16_t coef, int16_t offset) {
+    int32_t v = (int32_t)raw * gain + (int32_t)dp * coef +
+                (1 << (D6T_CALIB_Q - 1));
+    v = (v >> D6T_CALIB_Q) + offset;
+    v = v < INT16_MIN ? INT16_MIN : v;
+    v = v > INT16_MAX ? INT16_MAX : v;
+    return (int16_t)v;
+}
+
+/** <!-- d6t_calib_load {{{1 --> load a calibration file.
+ * one pixel per line: `index offset[degC] gain [ptat_coef]`,
+ * `ptat_ref degC` sets the PTAT reference of the PTAT terms,
+ * `#` starts a comment. the pixels not in the file are not corrected.
+ * gain and ptat_coef are limited in (-2, 2) to keep them in int16 Q14.
+ * scale is the raw units per degC of the pixel data (10 or 5).
+ */
+int d6t_calib_load(d6t_calib_t* c, const char* path, int n, double scale) {
+    char line[256];
+    int lineno = 0, i;
+    FILE* fp;
+
+    if (n < 1 || n > D6T_CALIB_MAX_PIXEL) {
+        return -1;
+    }
+    memset(c, 0, sizeof(*c));
+    c->n = n;
+    for (i = 0; i < n; i++) {
+        c->gain[i] = (int16_t)(1 << D6T_CALIB_Q);
+    }
+    if ((fp = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "Failed to open calibration: %s\n", path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        double ref, offset, gain, coef = 0.0;
+        char* hash = strchr(line, '#');
+        lineno++;
+        if (hash != NULL) {
+            *hash = '\0';
+        }
+        if (sscanf(line, " ptat_ref %lf", &ref) == 1) {
+            c->ptat_ref = (int16_t)round_i32(ref * 10.0);
+            continue;
+        }
+        int ret = sscanf(line, "%d %lf %lf %lf", &i, &offset, &gain, &coef);
+        if (ret == EOF || ret == 0) {
+            continue;  // blank or comment.
+        }
+        coef *= scale / 10.0;  // to raw pixel units per raw PTAT unit.
+        if (ret < 3 || i < 0 || i >= n ||
+            gain <= -2.0 || gain >= 2.0 || coef <= -2.0 || coef >= 2.0) {
+            fprintf(stderr, "%s:%d: broken calibration line\n", path, lineno);
+            fclose(fp);
+            return -1;
+        }
+        c->offset[i] = (int16_t)round_i32(offset * scale);
+        c->gain[i] = to_q(gain);
+        c->ptat_coef[i] = to_q(coef);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/** <!-- d6t_calib_decode {{{1 --> convert and calibrate in one pass.
+ * buf is the read buffer (PTAT at 0, pixels from 2), the correction
+ * is applied on the same traversal as the byte stream conversion.
+ */
+void d6t_calib_decode(const d6t_calib_t* c, const uint8_t* buf, int16_t* out) {
+    int i;
+    int16_t dp = calib_dp(c, buf);
+    const uint8_t* p = buf + 2;
+
+    for (i = 0; i < c->n; i++) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        int16_t raw;
+        memcpy(&raw, p + 2 * i, sizeof(raw));  // plain 16bit load.
+#else
+        int32_t raw = (int16_t)((uint16_t)p[2 * i] |
+                                ((uint16_t)p[2 * i + 1] << 8));
+#endif
+        out[i] = calib_pixel(raw, c->gain[i], dp, c->ptat_coef[i],
+                             c->offset[i]);
+    }
+}
+
+/** <!-- d6t_calib_decode_idx {{{1 --> convert and calibrate some pixels.
+ * same as d6t_calib_decode() for the pixel indexes of a region.
+ */
+void d6t_calib_decode_idx(const d6t_calib_t* c, const uint8_t* buf,
+                          const uint16_t* idx, int n, int16_t* out) {
+    int i;
+    int16_t dp = calib_dp(c, buf);
+
+    for (i = 0; i < n; i++) {
+        int k = idx[i];
+        const uint8_t* p = buf + 2 + 2 * k;
+        int32_t raw = (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+        out[i] = calib_pixel(raw, c->gain[k], dp, c->ptat_coef[k],
+                             c->offset[k]);
+    }
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,54 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_CALIB_H_
+#define D6T_CALIB_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* defines */
+#define D6T_CALIB_MAX_PIXEL (32 * 32)
+#define D6T_CALIB_Q 14  // fraction bits of gain and PTAT coefficient
+
+/** <!-- d6t_calib_t {{{1 --> per-pixel calibration of a sensor.
+ * calibrated = raw * gain + offset + ptat_coef * (PTAT - ptat_ref),
+ * in raw pixel units, gain and ptat_coef in Q14.
+ * the tables are int16 to keep the fused conversion on 16bit lanes.
+ */
+typedef struct d6t_calib {
+    int n;              // number of pixels
+    int16_t ptat_ref;   // PTAT reference for the PTAT term (0.1 degC)
+    int16_t gain[D6T_CALIB_MAX_PIXEL];
+    int16_t ptat_coef[D6T_CALIB_MAX_PIXEL];
+    int16_t offset[D6T_CALIB_MAX_PIXEL];
+} d6t_calib_t;
+
+int d6t_calib_load(d6t_calib_t* c, const char* path, int n, double scale);
+void d6t_calib_decode(const d6t_calib_t* c, const uint8_t* buf, int16_t* out);
+void d6t_calib_decode_idx(const d6t_calib_t* c, const uint8_t* buf,
+                          const uint16_t* idx, int n, int16_t* out);
+
+#endif  // D6T_CALIB_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
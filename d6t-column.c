@@ -0,0 +1,321 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "d6t-column.h"
+
+/* defines */
+#define BYTE_ORDER_MARK 0x01020304u
+#define ALIGN_UP(n) (((n) + D6T_COLUMN_ALIGN - 1) & ~(D6T_COLUMN_ALIGN - 1))
+
+/** <!-- little_endian {{{1 --> the columns are used in the host order.
+ */
+static bool little_endian(void) {
+    uint32_t v = BYTE_ORDER_MARK;
+    uint8_t b;
+    memcpy(&b, &v, 1);
+    return b == 0x04;
+}
+
+/** <!-- write_pad {{{1 --> write data and zeros up to the alignment.
+ */
+static int write_pad(d6t_column_writer_t* w, const void* data, size_t len) {
+    static const uint8_t zero[D6T_COLUMN_ALIGN];
+    size_t pad = ALIGN_UP(len) - len;
+
+    if (fwrite(data, 1, len, w->fp) != len ||
+        fwrite(zero, 1, pad, w->fp) != pad) {
+        return -1;
+    }
+    w->offset += len + pad;
+    return 0;
+}
+
+/** <!-- d6t_column_create {{{1 --> create a column file.
+ * frames are batched by `batch` frames, all frames must have n_pixel.
+ */
+int d6t_column_create(d6t_column_writer_t* w, const char* path,
+                      int n_pixel, int batch) {
+    uint8_t hdr[D6T_COLUMN_HEADER];
+    uint32_t v;
+
+    memset(w, 0, sizeof(*w));
+    if (!little_endian()) {
+        fprintf(stderr, "column files are for little-endian hosts\n");
+        return -1;
+    }
+    if (n_pixel < 1 || n_pixel > D6T_RECORD_MAX_PIXEL || batch < 1) {
+        return -1;
+    }
+    w->n_pixel = n_pixel;
+    w->batch = batch;
+    w->stride = ALIGN_UP(batch * 2) / 2;
+    w->ts = malloc(batch * sizeof(int64_t));
+    w->sensor = malloc(batch * sizeof(uint16_t));
+    w->ptat = malloc(batch * sizeof(int16_t));
+    w->pix = malloc((size_t)n_pixel * w->stride * sizeof(int16_t));
+    if (w->ts == NULL || w->sensor == NULL || w->ptat == NULL ||
+        w->pix == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    if ((w->fp = fopen(path, "wb")) == NULL) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        return -1;
+    }
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, D6T_COLUMN_MAGIC, 8);
+    v = 1;
+    memcpy(hdr + 8, &v, 4);
+    v = BYTE_ORDER_MARK;
+    memcpy(hdr + 12, &v, 4);
+    v = (uint32_t)n_pixel;
+    memcpy(hdr + 16, &v, 4);
+    v = (uint32_t)batch;
+    memcpy(hdr + 20, &v, 4);
+    snprintf((char*)hdr + 32, D6T_COLUMN_HEADER - 32, "%s",
+             D6T_COLUMN_SCHEMA);
+    return write_pad(w, hdr, sizeof(hdr));
+}
+
+/** <!-- flush_batch {{{1 --> write the batched frames.
+ */
+static int flush_batch(d6t_column_writer_t* w) {
+    uint8_t hdr[D6T_COLUMN_BATCH_HEADER];
+    d6t_column_index_t* idx;
+    uint32_t v;
+    uint64_t off[4];
+    int n = w->n, i, p;
+    int stride = ALIGN_UP(n * 2) / 2;  // a short last batch is packed.
+
+    if (n == 0) {
+        return 0;
+    }
+    if (w->n_batch >= w->cap_batch) {
+        long cap = w->cap_batch > 0 ? w->cap_batch * 2 : 64;
+        idx = realloc(w->index, cap * sizeof(d6t_column_index_t));
+        if (idx == NULL) {
+            return -1;
+        }
+        w->index = idx;
+        w->cap_batch = cap;
+    }
+    idx = &w->index[w->n_batch++];
+    idx->offset = w->offset;
+    idx->n_frame = (uint32_t)n;
+    idx->reserved = 0;
+    idx->ts_min = idx->ts_max = w->ts[0];
+    for (i = 1; i < n; i++) {
+        idx->ts_min = w->ts[i] < idx->ts_min ? w->ts[i] : idx->ts_min;
+        idx->ts_max = w->ts[i] > idx->ts_max ? w->ts[i] : idx->ts_max;
+    }
+    off[0] = D6T_COLUMN_BATCH_HEADER;
+    off[1] = off[0] + ALIGN_UP(n * sizeof(int64_t));
+    off[2] = off[1] + ALIGN_UP(n * sizeof(uint16_t));
+    off[3] = off[2] + ALIGN_UP(n * sizeof(int16_t));
+
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, "BATC", 4);
+    v = (uint32_t)n;
+    memcpy(hdr + 4, &v, 4);
+    v = (uint32_t)stride;
+    memcpy(hdr + 8, &v, 4);
+    memcpy(hdr + 16, &idx->ts_min, 8);
+    memcpy(hdr + 24, &idx->ts_max, 8);
+    memcpy(hdr + 32, off, sizeof(off));
+    if (write_pad(w, hdr, sizeof(hdr)) ||
+        write_pad(w, w->ts, n * sizeof(int64_t)) ||
+        write_pad(w, w->sensor, n * sizeof(uint16_t)) ||
+        write_pad(w, w->ptat, n * sizeof(int16_t))) {
+        return -1;
+    }
+    for (p = 0; p < w->n_pixel; p++) {
+        if (write_pad(w, w->pix + (size_t)p * w->stride,
+                      n * sizeof(int16_t))) {
+            return -1;
+        }
+    }
+    w->n_frame += n;
+    w->n = 0;
+    return 0;
+}
+
+/** <!-- d6t_column_append {{{1 --> add a frame to the current batch.
+ * the pixels are scattered to their columns, the batch is written
+ * when it is full.
+ */
+int d6t_column_append(d6t_column_writer_t* w, const d6t_record_t* r) {
+    int p, n = w->n;
+
+    if (r->n_pixel != w->n_pixel) {
+        return -1;
+    }
+    w->ts[n] = r->ts_ns;
+    w->sensor[n] = r->sensor;
+    w->ptat[n] = r->ptat;
+    for (p = 0; p < w->n_pixel; p++) {
+        w->pix[(size_t)p * w->stride + n] = r->pix[p];
+    }
+    w->n = n + 1;
+    return w->n >= w->batch ? flush_batch(w) : 0;
+}
+
+/** <!-- d6t_column_close {{{1 --> write the last batch and the index.
+ * n_batch, n_frame and offset (the file size) are left for a report.
+ */
+int d6t_column_close(d6t_column_writer_t* w) {
+    uint8_t trailer[D6T_COLUMN_TRAILER];
+    uint64_t v[3];
+    int ret = -1;
+
+    if (w->fp != NULL && flush_batch(w) == 0) {
+        v[0] = w->offset;
+        v[1] = (uint64_t)w->n_batch;
+        v[2] = w->n_frame;
+        memcpy(trailer, "D6TIDX1", 8);
+        memcpy(trailer + 8, v, sizeof(v));
+        if (write_pad(w, w->index, w->n_batch * sizeof(d6t_column_index_t))
+            == 0 && fwrite(trailer, 1, sizeof(trailer), w->fp) ==
+            sizeof(trailer)) {
+            ret = 0;
+        }
+    }
+    if (w->fp != NULL && fclose(w->fp) != 0) {
+        ret = -1;
+    }
+    free(w->ts);
+    free(w->sensor);
+    free(w->ptat);
+    free(w->pix);
+    free(w->index);
+    w->ts = NULL;  // the counts are kept for a report.
+    w->sensor = NULL;
+    w->ptat = NULL;
+    w->pix = NULL;
+    w->index = NULL;
+    w->fp = NULL;
+    return ret;
+}
+
+/** <!-- d6t_column_open {{{1 --> map a column file and check it.
+ */
+int d6t_column_open(d6t_column_file_t* f, const char* path) {
+    struct stat st;
+    uint32_t v[4];
+    uint64_t t[3];
+
+    memset(f, 0, sizeof(*f));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    f->size = (size_t)st.st_size;
+    if (f->size >= D6T_COLUMN_HEADER + D6T_COLUMN_TRAILER) {
+        void* map = mmap(NULL, f->size, PROT_READ, MAP_SHARED, fd, 0);
+        f->map = map == MAP_FAILED ? NULL : map;
+    }
+    close(fd);
+    if (f->map == NULL || memcmp(f->map, D6T_COLUMN_MAGIC, 8) != 0) {
+        fprintf(stderr, "not a column file: %s\n", path);
+        d6t_column_unmap(f);
+        return -1;
+    }
+    memcpy(v, f->map + 8, sizeof(v));
+    const uint8_t* tr = f->map + f->size - D6T_COLUMN_TRAILER;
+    memcpy(t, tr + 8, sizeof(t));
+    if (v[0] != 1 || v[1] != BYTE_ORDER_MARK ||
+        v[2] < 1 || v[2] > D6T_RECORD_MAX_PIXEL ||
+        memcmp(tr, "D6TIDX1", 8) != 0 || t[0] % D6T_COLUMN_ALIGN != 0 ||
+        t[0] + t[1] * sizeof(d6t_column_index_t) >
+        f->size - D6T_COLUMN_TRAILER) {
+        fprintf(stderr, "broken or unsupported column file: %s\n", path);
+        d6t_column_unmap(f);
+        return -1;
+    }
+    f->n_pixel = (int)v[2];
+    f->index = (const d6t_column_index_t*)(f->map + t[0]);
+    f->n_batch = (long)t[1];
+    f->n_frame = t[2];
+    return 0;
+}
+
+/** <!-- d6t_column_batch {{{1 --> columns of the batch k.
+ * returns 0, or -1 for a broken batch.
+ */
+int d6t_column_batch(const d6t_column_file_t* f, long k,
+                     d6t_column_batch_t* b) {
+    uint32_t v[2];
+    uint64_t off[4];
+
+    if (k < 0 || k >= f->n_batch) {
+        return -1;
+    }
+    uint64_t pos = f->index[k].offset;
+    if (pos % D6T_COLUMN_ALIGN != 0 ||
+        pos + D6T_COLUMN_BATCH_HEADER > f->size) {
+        return -1;
+    }
+    const uint8_t* hdr = f->map + pos;
+    memcpy(v, hdr + 4, sizeof(v));
+    memcpy(off, hdr + 32, sizeof(off));
+    uint64_t n = v[0];
+    if (memcmp(hdr, "BATC", 4) != 0 || n < 1 || v[1] != ALIGN_UP(n * 2) / 2 ||
+        off[0] != D6T_COLUMN_BATCH_HEADER ||
+        off[1] != off[0] + ALIGN_UP(n * sizeof(int64_t)) ||
+        off[2] != off[1] + ALIGN_UP(n * sizeof(uint16_t)) ||
+        off[3] != off[2] + ALIGN_UP(n * sizeof(int16_t)) ||
+        pos + off[3] + (uint64_t)f->n_pixel * v[1] * 2 > f->size) {
+        return -1;
+    }
+    b->n_frame = (int)v[0];
+    b->stride = (int)v[1];
+    memcpy(&b->ts_min, hdr + 16, 8);
+    memcpy(&b->ts_max, hdr + 24, 8);
+    b->ts = (const int64_t*)(hdr + off[0]);
+    b->sensor = (const uint16_t*)(hdr + off[1]);
+    b->ptat = (const int16_t*)(hdr + off[2]);
+    b->pix = (const int16_t*)(hdr + off[3]);
+    return 0;
+}
+
+/** <!-- d6t_column_unmap {{{1 --> release the file map.
+ */
+void d6t_column_unmap(d6t_column_file_t* f) {
+    if (f->map != NULL) {
+        munmap((void*)f->map, f->size);
+    }
+    memset(f, 0, sizeof(*f));
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_COLUMN_H_
+#define D6T_COLUMN_H_
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "d6t-record.h"
+
+/* defines */
+#define D6T_COLUMN_MAGIC "D6TCOL1"  // 8 bytes with the terminator
+#define D6T_COLUMN_ALIGN 64         // alignment of the columns
+#define D6T_COLUMN_HEADER 256
+#define D6T_COLUMN_BATCH_HEADER 64
+#define D6T_COLUMN_TRAILER 32
+#define D6T_COLUMN_SCHEMA "ts_ns:int64,sensor:uint16,ptat:int16," \
+                          "pix:int16[n_pixel][n_frame]"
+
+/** <!-- file layout {{{1 -->
+ * little-endian, every part and every column is 64 byte aligned,
+ * the columns can be used in place from a mmap-ed file.
+ *
+ * header (256):  magic[8] "D6TCOL1", u32 version (1),
+ *                u32 byte order (0x01020304), u32 n_pixel,
+ *                u32 batch (frames per batch), char schema[224]
+ * batch (64 + columns):
+ *                magic[4] "BATC", u32 n_frame, u32 stride (frames of a
+ *                pixel column, with padding), u32 reserved,
+ *                i64 ts_min, i64 ts_max,
+ *                u64 offsets of ts, sensor, ptat and pix from the batch,
+ *                columns: i64 ts[n_frame], u16 sensor[n_frame],
+ *                i16 ptat[n_frame], i16 pix[n_pixel][stride]
+ * index:         d6t_column_index_t of each batch
+ * trailer (32):  magic[8] "D6TIDX1", u64 index offset, u64 n_batch,
+ *                u64 n_frame
+ */
+
+/** <!-- d6t_column_index_t {{{1 --> a batch in the index at the end.
+ */
+typedef struct d6t_column_index {
+    uint64_t offset;    // of the batch header from the file head
+    uint32_t n_frame;
+    uint32_t reserved;
+    int64_t ts_min;
+    int64_t ts_max;
+} d6t_column_index_t;
+
+/** <!-- d6t_column_writer_t {{{1 --> columns of the frames being batched.
+ */
+typedef struct d6t_column_writer {
+    FILE* fp;
+    int n_pixel;
+    int batch;          // frames per batch
+    int stride;         // batch rounded up to the column alignment
+    int n;              // frames in the current batch
+    int64_t* ts;
+    uint16_t* sensor;
+    int16_t* ptat;
+    int16_t* pix;       // n_pixel columns of stride frames
+    d6t_column_index_t* index;
+    long n_batch, cap_batch;
+    uint64_t offset;    // file size written
+    uint64_t n_frame;
+} d6t_column_writer_t;
+
+/** <!-- d6t_column_batch_t {{{1 --> columns of a batch, in the file map.
+ * the frame i of pixel p is pix[p * stride + i].
+ */
+typedef struct d6t_column_batch {
+    int n_frame;
+    int stride;
+    int64_t ts_min, ts_max;
+    const int64_t* ts;
+    const uint16_t* sensor;
+    const int16_t* ptat;
+    const int16_t* pix;
+} d6t_column_batch_t;
+
+/** <!-- d6t_column_file_t {{{1 --> a mmap-ed column file.
+ */
+typedef struct d6t_column_file {
+    const uint8_t* map;
+    size_t size;
+    int n_pixel;
+    long n_batch;
+    uint64_t n_frame;
+    const d6t_column_index_t* index;
+} d6t_column_file_t;
+
+/* writer */
+int d6t_column_create(d6t_column_writer_t* w, const char* path,
+                      int n_pixel, int batch);
+int d6t_column_append(d6t_column_writer_t* w, const d6t_record_t* r);
+int d6t_column_close(d6t_column_writer_t* w);
+
+/* reader */
+int d6t_column_open(d6t_column_file_t* f, const char* path);
+int d6t_column_batch(const d6t_column_file_t* f, long k,
+                     d6t_column_batch_t* b);
+void d6t_column_unmap(d6t_column_file_t* f);
+
+#endif  // D6T_COLUMN_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,203 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "d6t-delta.h"
+#include "d6t-text.h"
+
+/** <!-- d6t_delta_init {{{1 --> initialize the tile state.
+ * the same state is used on both sides of the stream,
+ * the sender and the receiver must agree on n_row and tile.
+ */
+int d6t_delta_init(d6t_delta_t* d, int n_row, int tile,
+                   int deadband, int keyframe) {
+    if (n_row <= 0 || n_row * n_row > D6T_DELTA_MAX_PIXEL ||
+        tile <= 0 || n_row % tile != 0) {
+        return -1;
+    }
+    memset(d, 0, sizeof(*d));
+    d->n_row = n_row;
+    d->tile = tile;
+    d->n_tile = (n_row / tile) * (n_row / tile);
+    d->deadband = deadband < 0 ? 0 : deadband;
+    d->keyframe = keyframe < 0 ? 0 : keyframe;
+    return 0;
+}
+
+/** <!-- tile_origin {{{1 --> pixel index of the top-left corner of a tile.
+ */
+static int tile_origin(const d6t_delta_t* d, int idx) {
+    int n_col = d->n_row / d->tile;
+    return (idx / n_col) * d->tile * d->n_row + (idx % n_col) * d->tile;
+}
+
+/** <!-- d6t_delta_encode {{{1 --> mark changed tiles of a new frame.
+ * a tile is dirty when any pixel moved more than the deadband from
+ * the last emitted value, the emitted values are latched for dirty tiles.
+ * every tile is dirty on a keyframe.
+ * returns the number of dirty tiles.
+ */
+int d6t_delta_encode(d6t_delta_t* d, int16_t ptat, const int16_t* pix,
+                     bool* key) {
+    int t, x, y, n_dirty = 0;
+    bool full = !d->valid || (d->keyframe > 0 && d->count >= d->keyframe);
+
+    d->ptat = ptat;
+    for (t = 0; t < d->n_tile; t++) {
+        int org = tile_origin(d, t);
+        bool dirty = full;
+        for (y = 0; y < d->tile && !dirty; y++) {
+            const int16_t* src = pix + org + y * d->n_row;
+            const int16_t* ref = d->last + org + y * d->n_row;
+            for (x = 0; x < d->tile; x++) {
+                int diff = src[x] - ref[x];
+                if (diff > d->deadband || -diff > d->deadband) {
+                    dirty = true;
+                    break;
+                }
+            }
+        }
+        if (dirty) {
+            for (y = 0; y < d->tile; y++) {
+                memcpy(d->last + org + y * d->n_row, pix + org + y * d->n_row,
+                       d->tile * sizeof(int16_t));
+            }
+            n_dirty++;
+        }
+        d->dirty[t] = dirty;
+    }
+    if (full) {
+        d->valid = true;
+        d->count = 0;
+    }
+    d->count++;
+    *key = full;
+    return n_dirty;
+}
+
+/** <!-- d6t_delta_sprint {{{1 --> format the last encoded frame.
+ * keyframes use the same line format as the full frame output,
+ * delta frames list the dirty tiles as `#index` and the tile values.
+ * a buffer of D6T_DELTA_LINE_MAX fits the worst case, 1x1 tiles all dirty.
+ * returns the line length, or -1 if the buffer is too short.
+ */
+int d6t_delta_sprint(const d6t_delta_t* d, char* buf, size_t len, bool key) {
+    int t, x, y;
+    d6t_text_t line;
+
+    d6t_text_init(&line, buf, len);
+    d6t_text_put(&line, "PTAT: %4.1f [degC], %s: ", (double)d->ptat / 10.0,
+                 key ? "Temperature" : "Delta");
+    if (key) {  // row-major over the whole frame.
+        for (t = 0; t < d->n_row * d->n_row; t++) {
+            d6t_text_put(&line, "%4.1f, ", (double)d->last[t] / 10.0);
+        }
+    }
+    for (t = 0; t < d->n_tile && !key; t++) {
+        if (!d->dirty[t]) {
+            continue;
+        }
+        int org = tile_origin(d, t);
+        d6t_text_put(&line, "#%d ", t);
+        for (y = 0; y < d->tile; y++) {
+            const int16_t* src = d->last + org + y * d->n_row;
+            for (x = 0; x < d->tile; x++) {
+                d6t_text_put(&line, "%4.1f, ", (double)src[x] / 10.0);
+            }
+        }
+    }
+    d6t_text_put(&line, "[degC]\n");
+    return d6t_text_end(&line);
+}
+
+/** <!-- d6t_delta_apply_tile {{{1 --> update a tile on the receiver.
+ */
+int d6t_delta_apply_tile(d6t_delta_t* d, int idx, const int16_t* vals) {
+    int y;
+    if (idx < 0 || idx >= d->n_tile) {
+        return -1;
+    }
+    int org = tile_origin(d, idx);
+    for (y = 0; y < d->tile; y++) {
+        memcpy(d->last + org + y * d->n_row, vals + y * d->tile,
+               d->tile * sizeof(int16_t));
+    }
+    return 0;
+}
+
+/** <!-- d6t_delta_apply_line {{{1 --> reconstruct a frame from a line.
+ * accepts both keyframes (full frame lines) and delta lines,
+ * the reconstructed frame is in d->last, PTAT in d->ptat.
+ * returns 1 for a keyframe, 0 for a delta,
+ * -1 for a broken line or a delta before the first keyframe.
+ */
+int d6t_delta_apply_line(d6t_delta_t* d, const char* line) {
+    int i;
+    int16_t vals[D6T_DELTA_MAX_PIXEL];
+    const char* p = strstr(line, "PTAT:");
+
+    if (p == NULL) {
+        return -1;
+    }
+    p += 5;
+    if (d6t_text_parse_value(&p, &d->ptat)) {
+        return -1;
+    }
+    if ((p = strstr(line, "Temperature:")) != NULL) {
+        p += 12;
+        for (i = 0; i < d->n_row * d->n_row; i++) {
+            if (d6t_text_parse_value(&p, &vals[i])) {
+                return -1;
+            }
+        }
+        memcpy(d->last, vals, d->n_row * d->n_row * sizeof(int16_t));
+        d->valid = true;
+        return 1;
+    }
+    if ((p = strstr(line, "Delta:")) == NULL || !d->valid) {
+        return -1;
+    }
+    p += 6;
+    while (*p == ' ') {
+        p++;
+    }
+    while (*p == '#') {
+        char* end;
+        int idx = (int)strtol(p + 1, &end, 10);
+        p = end;
+        for (i = 0; i < d->tile * d->tile; i++) {
+            if (d6t_text_parse_value(&p, &vals[i])) {
+                return -1;
+            }
+        }
+        if (d6t_delta_apply_tile(d, idx, vals)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
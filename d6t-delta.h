@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_DELTA_H_
+#define D6T_DELTA_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* defines */
+#define D6T_DELTA_MAX_PIXEL (32 * 32)
+#define D6T_DELTA_MAX_TILE  D6T_DELTA_MAX_PIXEL
+#define D6T_DELTA_VALUE_MAX 9        // "-3276.8, "
+#define D6T_DELTA_INDEX_MAX 6        // "#1023 "
+#define D6T_DELTA_LINE_MAX  (64 + D6T_DELTA_MAX_PIXEL * \
+                             (D6T_DELTA_INDEX_MAX + D6T_DELTA_VALUE_MAX))
+
+/** <!-- d6t_delta_t {{{1 --> tile state, shared by sender and receiver.
+ * pixel values are kept in raw sensor units (0.1 degC).
+ */
+typedef struct d6t_delta {
+    int n_row;          // frame rows (= columns, square frames only)
+    int tile;           // tile edge in pixels, must divide n_row
+    int n_tile;         // number of tiles in a frame
+    int deadband;       // per-pixel deadband in raw units
+    int keyframe;       // full frame interval in frames, 0: first only
+    int count;          // frames since the last keyframe
+    bool valid;         // receiver: a keyframe has been seen
+    int16_t ptat;
+    int16_t last[D6T_DELTA_MAX_PIXEL];  // last emitted/received values
+    uint8_t dirty[D6T_DELTA_MAX_TILE];
+} d6t_delta_t;
+
+int d6t_delta_init(d6t_delta_t* d, int n_row, int tile,
+                   int deadband, int keyframe);
+
+/* sender */
+int d6t_delta_encode(d6t_delta_t* d, int16_t ptat, const int16_t* pix,
+                     bool* key);
+int d6t_delta_sprint(const d6t_delta_t* d, char* buf, size_t len, bool key);
+
+/* receiver (reconstruction) */
+int d6t_delta_apply_tile(d6t_delta_t* d, int idx, const int16_t* vals);
+int d6t_delta_apply_line(d6t_delta_t* d, const char* line);
+
+#endif  // D6T_DELTA_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "d6t-delta.h"
+
+/* defines */
+#define N_ROW 32
+#define N_PIXEL (32 * 32)
+
+/** <!-- main - change-only output statistics {{{1 -->
+ * replay a recorded d6t-32l output (full frame lines) from stdin,
+ * encode it as change-only output, reconstruct it with the receiver
+ * and report the output size against the full frame output.
+ *
+ * options: same as d6t-32l, -d deadband, -t tile, -k frames.
+ */
+int main(int argc, char* argv[]) {
+    int i, opt;
+    int deadband = 0, tile = 8, keyframe = 30;
+    static d6t_delta_t in, tx, rx;
+    static char out[D6T_DELTA_LINE_MAX];
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    long n_frame = 0, n_key = 0, n_tile = 0, n_err = 0;
+    long long full_bytes = 0, delta_bytes = 0;
+    int max_err = 0;
+
+    while ((opt = getopt(argc, argv, "d:t:k:")) != -1) {
+        switch (opt) {
+        case 'd': deadband = atoi(optarg); break;
+        case 't': tile = atoi(optarg); break;
+        case 'k': keyframe = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-d deadband] [-t tile] [-k frames]"
+                    " < d6t-32l.log\n", argv[0]);
+            return 1;
+        }
+    }
+    d6t_delta_init(&in, N_ROW, N_ROW, 0, 0);
+    if (d6t_delta_init(&tx, N_ROW, tile, deadband, keyframe) ||
+        d6t_delta_init(&rx, N_ROW, tile, deadband, keyframe)) {
+        fprintf(stderr, "tile must divide %d\n", N_ROW);
+        return 1;
+    }
+
+    while ((len = getline(&line, &cap, stdin)) > 0) {
+        bool key;
+        if (d6t_delta_apply_line(&in, line) != 1) {
+            continue;  // not a full frame line.
+        }
+        n_tile += d6t_delta_encode(&tx, in.ptat, in.last, &key);
+        int n = d6t_delta_sprint(&tx, out, sizeof(out), key);
+        if (n < 0 || d6t_delta_apply_line(&rx, out) < 0) {
+            n_err++;
+            continue;
+        }
+        for (i = 0; i < N_PIXEL; i++) {
+            int diff = abs(rx.last[i] - in.last[i]);
+            max_err = diff > max_err ? diff : max_err;
+        }
+        n_frame++;
+        n_key += key;
+        full_bytes += len;
+        delta_bytes += n;
+    }
+    free(line);
+
+    if (n_frame < 1) {
+        fprintf(stderr, "no frames in input.\n");
+        return 1;
+    }
+    printf("frames: %ld, keyframes: %ld, errors: %ld\n",
+           n_frame, n_key, n_err);
+    printf("tiles/frame: %.2f of %d\n",
+           (double)n_tile / n_frame, tx.n_tile);
+    printf("full: %lld bytes, delta: %lld bytes, saved: %.1f%%\n",
+           full_bytes, delta_bytes,
+           100.0 * (1.0 - (double)delta_bytes / full_bytes));
+    printf("max reconstruction error: %.1f [degC]\n", max_err / 10.0);
+    return 0;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
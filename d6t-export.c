@@ -0,0 +1,225 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "d6t-record.h"
+#include "d6t-column.h"
+
+/* recording to export */
+static d6t_column_writer_t writer;
+static long n_in, n_skip;
+
+/** <!-- export {{{1 --> append the frames of a recording to the columns.
+ * the column file is created by the first frame, for its pixel number,
+ * frames of other sensor types are skipped.
+ */
+static int export(FILE* fp, const char* path, int batch) {
+    static char line[D6T_RECORD_LINE_MAX + 80];
+    static d6t_record_t r;
+    int ret;
+
+    while ((ret = d6t_record_next(&r, fp, line, sizeof(line))) > 0) {
+        if (writer.fp == NULL &&
+            d6t_column_create(&writer, path, r.n_pixel, batch)) {
+            return -1;
+        }
+        if (d6t_column_append(&writer, &r)) {
+            n_skip++;
+            continue;
+        }
+        n_in++;
+    }
+    if (ret < 0) {
+        fprintf(stderr, "broken record at frame %ld\n", n_in + n_skip);
+    }
+    return ret;
+}
+
+/** <!-- query {{{1 --> output the frames of a column file in a time range.
+ * full frames as the text output of the samples, or the selected pixels
+ * as CSV. only the batches in the range and the selected columns are
+ * read from the file map.
+ */
+static int query(const char* path, int64_t t0, int64_t t1,
+                 const int* pix, int n_pix) {
+    static d6t_record_t r;
+    static char line[D6T_RECORD_LINE_MAX];
+    d6t_column_file_t f;
+    d6t_column_batch_t b;
+    long k;
+    int i, p;
+
+    if (d6t_column_open(&f, path)) {
+        return -1;
+    }
+    for (p = 0; p < n_pix; p++) {
+        if (pix[p] < 0 || pix[p] >= f.n_pixel) {
+            fprintf(stderr, "pixel %d out of %d\n", pix[p], f.n_pixel);
+            d6t_column_unmap(&f);
+            return -1;
+        }
+    }
+    if (n_pix > 0) {
+        printf("ts_ns,sensor,ptat");
+        for (p = 0; p < n_pix; p++) {
+            printf(",p%d", pix[p]);
+        }
+        printf("\n");
+    }
+    r.n_pixel = (uint16_t)f.n_pixel;
+    for (k = 0; k < f.n_batch; k++) {
+        if (f.index[k].ts_max < t0 || f.index[k].ts_min > t1) {
+            continue;  // not read at all.
+        }
+        if (d6t_column_batch(&f, k, &b)) {
+            fprintf(stderr, "broken batch %ld\n", k);
+            d6t_column_unmap(&f);
+            return -1;
+        }
+        for (i = 0; i < b.n_frame; i++) {
+            if (b.ts[i] < t0 || b.ts[i] > t1) {
+                continue;
+            }
+            if (n_pix > 0) {
+                printf("%lld,%u,%.1f", (long long)b.ts[i], b.sensor[i],
+                       b.ptat[i] / 10.0);
+                for (p = 0; p < n_pix; p++) {
+                    printf(",%.1f", b.pix[pix[p] * b.stride + i] / 10.0);
+                }
+                printf("\n");
+                continue;
+            }
+            r.ptat = b.ptat[i];
+            for (p = 0; p < f.n_pixel; p++) {
+                r.pix[p] = b.pix[p * b.stride + i];
+            }
+            if (b.ts[i] != 0) {
+                printf("TS: %lld.%09lld [s], ",
+                       (long long)(b.ts[i] / 1000000000),
+                       (long long)(b.ts[i] % 1000000000));
+            }
+            if (d6t_record_sprint(&r, line, sizeof(line)) > 0) {
+                fputs(line, stdout);
+            }
+        }
+    }
+    d6t_column_unmap(&f);
+    return 0;
+}
+
+/** <!-- main - columnar export {{{1 -->
+ * convert recorded frames (text output or binary records) to a column
+ * file, or output frames from a column file.
+ *
+ * options:
+ *   -o file:     column file to write.
+ *   -n frames:   frames per batch (default 1024).
+ *   -x file:     column file to read, the frames are output as text.
+ *   -s sec:      -x: first timestamp to output.
+ *   -e sec:      -x: last timestamp to output.
+ *   -p list:     -x: output the pixels of the list (e.g. 0,5,31) as CSV.
+ */
+int main(int argc, char* argv[]) {
+    int opt, batch = 1024;
+    const char* out = NULL;
+    const char* in = NULL;
+    int64_t t0 = INT64_MIN, t1 = INT64_MAX;
+    int pix[D6T_RECORD_MAX_PIXEL], n_pix = 0;
+    char* p;
+    char* end;
+    bool usage = false;
+
+    while ((opt = getopt(argc, argv, "o:n:x:s:e:p:")) != -1) {
+        switch (opt) {
+        case 'o': out = optarg; break;
+        case 'n': batch = atoi(optarg); break;
+        case 'x': in = optarg; break;
+        case 's': t0 = (int64_t)(atof(optarg) * 1e9); break;
+        case 'e': t1 = (int64_t)(atof(optarg) * 1e9); break;
+        case 'p':
+            for (p = optarg; *p != '\0'; p = end + (*end == ',')) {
+                long v = strtol(p, &end, 10);
+                if (end == p || n_pix >= D6T_RECORD_MAX_PIXEL) {
+                    usage = true;  // not a number, or too many.
+                    break;
+                }
+                pix[n_pix++] = (int)v;
+            }
+            break;
+        default:
+            usage = true;
+            break;
+        }
+    }
+    if (usage) {
+        out = in = NULL;
+    }
+    if (in != NULL) {
+        return query(in, t0, t1, pix, n_pix) ? 1 : 0;
+    }
+    if (out == NULL || batch < 1) {
+        fprintf(stderr, "usage: %s -o file [-n frames] [log ...]\n"
+                "       %s -x file [-s sec] [-e sec] [-p list]\n",
+                argv[0], argv[0]);
+        return 1;
+    }
+
+    if (optind >= argc && export(stdin, out, batch) < 0) {
+        d6t_column_close(&writer);
+        return 1;
+    }
+    for (; optind < argc; optind++) {
+        FILE* fp = fopen(argv[optind], "r");
+        if (fp == NULL) {
+            fprintf(stderr, "Failed to open: %s\n", argv[optind]);
+            d6t_column_close(&writer);
+            return 1;
+        }
+        int ret = export(fp, out, batch);
+        fclose(fp);
+        if (ret < 0) {
+            d6t_column_close(&writer);
+            return 1;
+        }
+    }
+    if (writer.fp == NULL) {
+        fprintf(stderr, "no frames in input.\n");
+        return 1;
+    }
+    if (d6t_column_close(&writer)) {
+        fprintf(stderr, "Failed to write: %s\n", out);
+        return 1;
+    }
+    fprintf(stderr, "exported: %ld frames in %ld batches, %llu bytes,"
+            " skipped %ld frames of other sensors\n", n_in, writer.n_batch,
+            (unsigned long long)writer.offset + D6T_COLUMN_TRAILER, n_skip);
+    return 0;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,166 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "d6t-filter.h"
+
+/** <!-- d6t_filter_init {{{1 --> setup a filter from the option string.
+ * `ema:shift` (1-8), `mean:frames` (2-16) or `median:frames` (3 or 5),
+ * NULL or `none` disables the filter.
+ */
+int d6t_filter_init(d6t_filter_t* f, const char* spec, int n) {
+    int param = 0;
+    const char* colon = spec == NULL ? NULL : strchr(spec, ':');
+
+    memset(f, 0, sizeof(*f));
+    f->n = n;
+    if (spec == NULL || strcmp(spec, "none") == 0) {
+        return 0;
+    }
+    if (colon != NULL) {
+        param = atoi(colon + 1);
+    }
+    if (strncmp(spec, "ema:", 4) == 0 && param >= 1 && param <= 8) {
+        f->type = D6T_FILTER_EMA;
+    } else if (strncmp(spec, "mean:", 5) == 0 &&
+               param >= 2 && param <= D6T_FILTER_MAX_WINDOW) {
+        f->type = D6T_FILTER_MEAN;
+    } else if (strncmp(spec, "median:", 7) == 0 &&
+               (param == 3 || param == 5)) {
+        f->type = D6T_FILTER_MEDIAN;
+    } else {
+        fprintf(stderr, "filter must be ema:1-8, mean:2-%d or median:3/5: %s\n",
+                D6T_FILTER_MAX_WINDOW, spec);
+        return -1;
+    }
+    if (n < 1 || n > D6T_FILTER_MAX_PIXEL) {
+        return -1;
+    }
+    f->param = param;
+    return 0;
+}
+
+/** <!-- d6t_filter_reset {{{1 --> drop the history, e.g. after re-init.
+ */
+void d6t_filter_reset(d6t_filter_t* f) {
+    f->primed = false;
+    f->pos = 0;
+}
+
+/** <!-- filter_prime {{{1 --> fill the state with the first frame.
+ */
+static void filter_prime(d6t_filter_t* f, const int16_t* in) {
+    int i, k;
+    int w = f->type == D6T_FILTER_EMA ? 1 : f->param;
+    for (k = 0; k < w; k++) {
+        memcpy(f->hist + k * f->n, in, f->n * sizeof(int16_t));
+    }
+    for (i = 0; i < f->n; i++) {
+        f->acc[i] = f->type == D6T_FILTER_EMA ?
+                    (int32_t)in[i] * (1 << D6T_FILTER_EMA_Q) :
+                    (int32_t)in[i] * w;
+    }
+    f->pos = 0;
+    f->primed = true;
+}
+
+static inline int16_t min16(int16_t a, int16_t b) {return a < b ? a : b;}
+static inline int16_t max16(int16_t a, int16_t b) {return a > b ? a : b;}
+
+/** <!-- d6t_filter_apply {{{1 --> filter a frame, in and out may be same.
+ * all updates are branch-free loops over the pixels in int16/int32.
+ */
+void d6t_filter_apply(d6t_filter_t* f, const int16_t* in, int16_t* out) {
+    int i, n = f->n;
+    int32_t* acc = f->acc;
+
+    if (f->type == D6T_FILTER_NONE) {
+        if (in != out) {
+            memcpy(out, in, n * sizeof(int16_t));
+        }
+        return;
+    }
+    if (!f->primed) {
+        filter_prime(f, in);
+    }
+
+    switch (f->type) {
+    case D6T_FILTER_EMA: {
+        int shift = f->param;
+        for (i = 0; i < n; i++) {
+            // a multiply, left shifts of negative pixels are undefined.
+            int32_t x = (int32_t)in[i] * (1 << D6T_FILTER_EMA_Q);
+            acc[i] += (x - acc[i]) >> shift;
+            out[i] = (int16_t)((acc[i] + (1 << (D6T_FILTER_EMA_Q - 1))) >>
+                               D6T_FILTER_EMA_Q);
+        }
+        break;
+    }
+    case D6T_FILTER_MEAN: {
+        int w = f->param;
+        int16_t* old = f->hist + f->pos * n;
+        for (i = 0; i < n; i++) {  // running sums, add new and drop oldest.
+            acc[i] += (int32_t)in[i] - old[i];
+            old[i] = in[i];
+        }
+        // divide by the window with a Q24 reciprocal, exact for 16 frames
+        // of int16 values, rounded to nearest.
+        int64_t recip = ((1 << 24) + w - 1) / w;
+        for (i = 0; i < n; i++) {
+            out[i] = (int16_t)((acc[i] * recip + (1 << 23)) >> 24);
+        }
+        f->pos = (f->pos + 1) % w;
+        break;
+    }
+    case D6T_FILTER_MEDIAN: {
+        int16_t* h = f->hist;
+        memcpy(h + f->pos * n, in, n * sizeof(int16_t));
+        f->pos = (f->pos + 1) % f->param;
+        if (f->param == 3) {
+            const int16_t *a = h, *b = h + n, *c = h + 2 * n;
+            for (i = 0; i < n; i++) {
+                out[i] = max16(min16(a[i], b[i]),
+                               min16(max16(a[i], b[i]), c[i]));
+            }
+        } else {
+            const int16_t *a = h, *b = h + n, *c = h + 2 * n;
+            const int16_t *d = h + 3 * n, *e = h + 4 * n;
+            for (i = 0; i < n; i++) {
+                // drop the min and the max of the 4 sorted pairs,
+                // then the median of 3.
+                int16_t x = max16(min16(a[i], b[i]), min16(c[i], d[i]));
+                int16_t y = min16(max16(a[i], b[i]), max16(c[i], d[i]));
+                out[i] = max16(min16(x, y), min16(max16(x, y), e[i]));
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,62 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_FILTER_H_
+#define D6T_FILTER_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* defines */
+#define D6T_FILTER_MAX_PIXEL (32 * 32)
+#define D6T_FILTER_MAX_WINDOW 16
+#define D6T_FILTER_EMA_Q 8  // fraction bits of the EMA state
+
+typedef enum d6t_filter_type {
+    D6T_FILTER_NONE = 0,
+    D6T_FILTER_EMA,     // exponential moving average, alpha = 1 / 2^param
+    D6T_FILTER_MEAN,    // sliding window mean over param frames
+    D6T_FILTER_MEDIAN,  // sliding window median over param (3 or 5) frames
+} d6t_filter_type_t;
+
+/** <!-- d6t_filter_t {{{1 --> per-pixel temporal filter state of a sensor.
+ * the state is a contiguous buffer, history is stored frame by frame
+ * to keep the per-pixel updates on consecutive memory.
+ */
+typedef struct d6t_filter {
+    d6t_filter_type_t type;
+    int n;              // number of pixels
+    int param;          // EMA shift or window length
+    int pos;            // next history slot
+    bool primed;        // state holds a frame
+    int32_t acc[D6T_FILTER_MAX_PIXEL];  // EMA state (Q8) or window sums
+    int16_t hist[D6T_FILTER_MAX_WINDOW * D6T_FILTER_MAX_PIXEL];
+} d6t_filter_t;
+
+int d6t_filter_init(d6t_filter_t* f, const char* spec, int n);
+void d6t_filter_reset(d6t_filter_t* f);
+void d6t_filter_apply(d6t_filter_t* f, const int16_t* in, int16_t* out);
+
+#endif  // D6T_FILTER_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
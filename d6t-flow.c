@@ -0,0 +1,316 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "d6t-flow.h"
+#include "d6t-text.h"
+
+/** <!-- d6t_flow_init {{{1 --> initialize the block matching.
+ * up is 2 to match n_row frames upsampled to 2 * n_row rows,
+ * the block must divide the matched rows and be a multiple of up.
+ */
+int d6t_flow_init(d6t_flow_t* f, int n_row, int up, int block, int range) {
+    int m_row = n_row * up;
+
+    memset(f, 0, sizeof(*f));
+    if ((up != 1 && up != 2) || n_row < 1 || m_row > D6T_FLOW_MAX_ROW ||
+        block < 2 || m_row % block != 0 || block % up != 0 ||
+        range < 1 || range > D6T_FLOW_MAX_RANGE) {
+        fprintf(stderr, "flow: block must divide %d and range 1 to %d\n",
+                m_row, D6T_FLOW_MAX_RANGE);
+        return -1;
+    }
+    f->n_row = n_row;
+    f->up = up;
+    f->m_row = m_row;
+    f->block = block;
+    f->range = range;
+    f->stride = m_row + 2 * range;
+    f->n_bcol = m_row / block;
+    f->n_block = f->n_bcol * f->n_bcol;
+    return 0;
+}
+
+/** <!-- d6t_flow_reset {{{1 --> forget the previous frame.
+ */
+void d6t_flow_reset(d6t_flow_t* f) {
+    f->valid = false;
+    memset(f->vx, 0, sizeof(f->vx));
+    memset(f->vy, 0, sizeof(f->vy));
+    memset(f->weight, 0, sizeof(f->weight));
+}
+
+/** <!-- d6t_flow_upsample {{{1 --> bilinear 2x upsampling in fixed point.
+ * an output pixel is 9:3:3:1 of its nearest input pixels (the output
+ * pixel centers are at 1/4 and 3/4 of an input pixel), edges replicated.
+ */
+void d6t_flow_upsample(const int16_t* src, int n_row, int16_t* dst) {
+    int x, y, m = n_row * 2;
+
+    for (y = 0; y < m; y++) {
+        int y0 = y / 2;
+        int y1 = y % 2 ? y0 + 1 : y0 - 1;
+        y1 = y1 < 0 ? 0 : y1 >= n_row ? n_row - 1 : y1;
+        const int16_t* a = src + y0 * n_row;
+        const int16_t* c = src + y1 * n_row;
+        for (x = 0; x < m; x++) {
+            int x0 = x / 2;
+            int x1 = x % 2 ? x0 + 1 : x0 - 1;
+            x1 = x1 < 0 ? 0 : x1 >= n_row ? n_row - 1 : x1;
+            int32_t v = 9 * a[x0] + 3 * a[x1] + 3 * c[x0] + c[x1];
+            dst[y * m + x] = (int16_t)((v + 8) >> 4);
+        }
+    }
+}
+
+/** <!-- flow_pad {{{1 --> keep the current frame as the previous one.
+ * the frame is padded by range pixels of the edge values, so shifted
+ * rows can be read without bounds checks.
+ */
+static void flow_pad(d6t_flow_t* f) {
+    int x, y, r = f->range, m = f->m_row;
+
+    for (y = -r; y < m + r; y++) {
+        int sy = y < 0 ? 0 : y >= m ? m - 1 : y;
+        const int16_t* src = f->cur + sy * m;
+        int16_t* dst = f->prev + (y + r) * f->stride;
+        for (x = 0; x < r; x++) {
+            dst[x] = src[0];
+            dst[m + r + x] = src[m - 1];
+        }
+        memcpy(dst + r, src, m * sizeof(int16_t));
+    }
+}
+
+/** <!-- flow_sad {{{1 --> SAD of all blocks for a shift.
+ * the absolute differences are summed per column over a band of block
+ * rows (a vectorized loop over the whole row), then per block.
+ */
+static void flow_sad(d6t_flow_t* f, int dx, int dy, int32_t* sad) {
+    int32_t acc[D6T_FLOW_MAX_ROW];
+    int bx, by, x, y, m = f->m_row, b = f->block;
+
+    for (by = 0; by < f->n_bcol; by++) {
+        memset(acc, 0, sizeof(acc));
+        for (y = by * b; y < (by + 1) * b; y++) {
+            const int16_t* cur = f->cur + y * m;
+            const int16_t* prev = f->prev + (y + dy + f->range) * f->stride +
+                                  dx + f->range;
+            for (x = 0; x < m; x++) {
+                acc[x] += abs(cur[x] - prev[x]);
+            }
+        }
+        for (bx = 0; bx < f->n_bcol; bx++) {
+            int32_t s = 0;
+            for (x = bx * b; x < (bx + 1) * b; x++) {
+                s += acc[x];
+            }
+            sad[by * f->n_bcol + bx] = s;
+        }
+    }
+}
+
+/** <!-- flow_refine {{{1 --> sub-pixel offset of a SAD minimum.
+ * the vertex of the parabola through the SAD at -1, 0 and +1,
+ * in 1/16 pixel.
+ */
+static int flow_refine(int32_t sm, int32_t s0, int32_t sp) {
+    int64_t den = 2 * ((int64_t)sm - 2 * (int64_t)s0 + sp);
+    if (den <= 0) {
+        return 0;
+    }
+    int64_t off = (((int64_t)sm - sp) << D6T_FLOW_Q) / den;
+    int half = 1 << (D6T_FLOW_Q - 1);
+    return off > half ? half : off < -half ? -half : (int)off;
+}
+
+/** <!-- d6t_flow_update {{{1 --> match a new frame to the previous one.
+ * pix is a sensor frame in raw units. a block is moving when its SAD
+ * has a contrast over the shifts (the block is not flat) and the vector
+ * is a quarter pixel or more.
+ * returns the number of moving blocks, 0 for the first frame.
+ */
+int d6t_flow_update(d6t_flow_t* f, const int16_t* pix) {
+    int k, s, dx, dy, n_moving = 0;
+    int r = f->range, w = 2 * r + 1, zero = r * w + r;
+    int32_t gain = D6T_FLOW_GAIN * f->block * f->block;
+
+    if (f->up == 2) {
+        d6t_flow_upsample(pix, f->n_row, f->cur);
+    } else {
+        memcpy(f->cur, pix, f->m_row * f->m_row * sizeof(int16_t));
+    }
+    if (!f->valid) {
+        flow_pad(f);
+        f->valid = true;
+        return 0;
+    }
+    for (s = 0, dy = -r; dy <= r; dy++) {
+        for (dx = -r; dx <= r; dx++, s++) {
+            flow_sad(f, dx, dy, f->sad[s]);
+        }
+    }
+    for (k = 0; k < f->n_block; k++) {
+        int best = zero;  // ties keep the zero shift.
+        int32_t hi = f->sad[zero][k];
+        for (s = 0; s < w * w; s++) {
+            int32_t v = f->sad[s][k];
+            best = v < f->sad[best][k] ? s : best;
+            hi = v > hi ? v : hi;
+        }
+        int32_t lo = f->sad[best][k];
+        int bx = best % w, by = best / w;
+        int qx = (bx - r) << D6T_FLOW_Q, qy = (by - r) << D6T_FLOW_Q;
+        if (bx > 0 && bx < w - 1) {
+            qx += flow_refine(f->sad[best - 1][k], lo, f->sad[best + 1][k]);
+        }
+        if (by > 0 && by < w - 1) {
+            qy += flow_refine(f->sad[best - w][k], lo, f->sad[best + w][k]);
+        }
+        // the previous block at +shift is now here, the motion is -shift.
+        bool moving = hi - lo >= gain &&
+                      abs(qx) + abs(qy) >= 1 << (D6T_FLOW_Q - 2);
+        f->vx[k] = (int16_t)(moving ? -qx : 0);
+        f->vy[k] = (int16_t)(moving ? -qy : 0);
+        f->weight[k] = moving ? hi - lo : 0;
+        n_moving += moving;
+    }
+    flow_pad(f);
+    return n_moving;
+}
+
+/** <!-- d6t_flow_roi {{{1 --> mean motion of a region.
+ * the vectors of the moving blocks are averaged over the region pixels
+ * (roi NULL for the whole frame), weighted by the SAD contrast of the
+ * blocks, in 1/16 pixel of the matched grid.
+ * returns the number of region pixels in moving blocks.
+ */
+int d6t_flow_roi(const d6t_flow_t* f, const d6t_roi_t* roi,
+                 int32_t* vx, int32_t* vy) {
+    int i, n = roi ? roi->n : f->n_row * f->n_row, n_moving = 0;
+    int64_t sx = 0, sy = 0, sw = 0;
+
+    for (i = 0; i < n; i++) {
+        int idx = roi ? roi->idx[i] : i;
+        int x = idx % f->n_row * f->up, y = idx / f->n_row * f->up;
+        int k = y / f->block * f->n_bcol + x / f->block;
+        if (f->weight[k] > 0) {
+            sx += (int64_t)f->vx[k] * f->weight[k];
+            sy += (int64_t)f->vy[k] * f->weight[k];
+            sw += f->weight[k];
+            n_moving++;
+        }
+    }
+    *vx = sw > 0 ? (int32_t)(sx / sw) : 0;
+    *vy = sw > 0 ? (int32_t)(sy / sw) : 0;
+    return n_moving;
+}
+
+/** <!-- flow_isqrt {{{1 --> integer square root.
+ */
+static uint32_t flow_isqrt(uint64_t v) {
+    uint64_t r = 0, bit = (uint64_t)1 << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+/** <!-- flow_direction {{{1 --> 8-way direction of a vector, y down.
+ * a vector within 22.5 degrees (tan ~ 5/12) of an axis is on the axis.
+ */
+static const char* flow_direction(int32_t vx, int32_t vy) {
+    static const char* const names[3][3] = {
+        {"up-left", "up", "up-right"},
+        {"left", "none", "right"},
+        {"down-left", "down", "down-right"},
+    };
+    int32_t ax = abs(vx), ay = abs(vy);
+    int col = vx > 0 ? 2 : vx < 0 ? 0 : 1;
+    int row = vy > 0 ? 2 : vy < 0 ? 0 : 1;
+
+    if (ay * 12 < ax * 5) {
+        row = 1;
+    } else if (ax * 12 < ay * 5) {
+        col = 1;
+    }
+    return names[row][col];
+}
+
+/** <!-- d6t_flow_sprint_field {{{1 --> format the vectors of all blocks.
+ * the vectors are in sensor pixels per frame, row-major over the blocks.
+ * returns the line length, or -1 if the buffer is too short.
+ */
+int d6t_flow_sprint_field(const d6t_flow_t* f, char* buf, size_t len) {
+    int k;
+    d6t_text_t line;
+    double unit = (double)(f->up << D6T_FLOW_Q);
+
+    d6t_text_init(&line, buf, len);
+    d6t_text_put(&line, "FLOW: Field: %dx%d, Vector: ", f->n_bcol,
+                 f->n_bcol);
+    for (k = 0; k < f->n_block; k++) {
+        d6t_text_put(&line, "%.2f %.2f, ", f->vx[k] / unit, f->vy[k] / unit);
+    }
+    d6t_text_put(&line, "[px/frame]\n");
+    return d6t_text_end(&line);
+}
+
+/** <!-- d6t_flow_sprint_roi {{{1 --> format the motion of a region.
+ * the mean vector and the speed are in sensor pixels per frame,
+ * roi NULL is the whole frame as `all`.
+ * returns the line length, or -1 if the buffer is too short.
+ */
+int d6t_flow_sprint_roi(const d6t_flow_t* f, const d6t_roi_t* roi,
+                        char* buf, size_t len) {
+    int32_t vx, vy;
+    int n_moving = d6t_flow_roi(f, roi, &vx, &vy);
+    d6t_text_t line;
+    double unit = (double)(f->up << D6T_FLOW_Q);
+    // Q8 of the Q4 vector length for two more bits.
+    uint32_t speed = flow_isqrt(((uint64_t)((int64_t)vx * vx +
+                                            (int64_t)vy * vy)) << 8);
+
+    d6t_text_init(&line, buf, len);
+    d6t_text_put(&line, "FLOW: ROI: %s, Moving: %d/%d, Vector: %.2f %.2f, "
+                 "Speed: %.2f [px/frame], Direction: %s\n",
+                 roi ? roi->name : "all", n_moving,
+                 roi ? roi->n : f->n_row * f->n_row, vx / unit, vy / unit,
+                 speed / (unit * 16.0), flow_direction(vx, vy));
+    return d6t_text_end(&line);
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_FLOW_H_
+#define D6T_FLOW_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "d6t-roi.h"
+
+/* defines */
+#define D6T_FLOW_MAX_ROW 32
+#define D6T_FLOW_MAX_PIXEL (D6T_FLOW_MAX_ROW * D6T_FLOW_MAX_ROW)
+#define D6T_FLOW_MAX_BLOCK (D6T_FLOW_MAX_PIXEL / 4)  // blocks of 2x2 or more
+#define D6T_FLOW_MAX_RANGE 3
+#define D6T_FLOW_MAX_STRIDE (D6T_FLOW_MAX_ROW + 2 * D6T_FLOW_MAX_RANGE)
+#define D6T_FLOW_MAX_SHIFT \
+    ((2 * D6T_FLOW_MAX_RANGE + 1) * (2 * D6T_FLOW_MAX_RANGE + 1))
+#define D6T_FLOW_Q 4            // vectors in 1/16 pixel
+#define D6T_FLOW_GAIN 2         // SAD contrast per pixel in raw units
+#define D6T_FLOW_LINE_MAX 8192
+
+/** <!-- d6t_flow_t {{{1 --> block matching state of a sensor.
+ * the frames are matched on a grid of up * n_row rows (D6T-44L is
+ * upsampled to 8x8), the SAD of every block is computed for all shifts
+ * in +-range pixels, a shift at a time over whole rows so the inner loop
+ * is vectorized. the best shift is refined to 1/16 pixel by a parabola.
+ * vectors are the motion from the previous frame, in 1/16 pixel of the
+ * matched grid, x to the right and y down.
+ */
+typedef struct d6t_flow {
+    int n_row;          // rows (= columns) of the sensor frame
+    int up;             // upsampling, 1 or 2
+    int m_row;          // rows of the matched grid
+    int block;          // block edge in the matched grid
+    int range;          // search range in pixels
+    int stride;         // row stride of the padded previous frame
+    int n_bcol;         // blocks in a row
+    int n_block;
+    bool valid;         // a previous frame is there
+    int16_t cur[D6T_FLOW_MAX_PIXEL];
+    int16_t prev[D6T_FLOW_MAX_STRIDE * D6T_FLOW_MAX_STRIDE];  // edge padded
+    int32_t sad[D6T_FLOW_MAX_SHIFT][D6T_FLOW_MAX_BLOCK];
+    int16_t vx[D6T_FLOW_MAX_BLOCK];
+    int16_t vy[D6T_FLOW_MAX_BLOCK];
+    int32_t weight[D6T_FLOW_MAX_BLOCK];  // SAD contrast, 0: not moving
+} d6t_flow_t;
+
+int d6t_flow_init(d6t_flow_t* f, int n_row, int up, int block, int range);
+void d6t_flow_reset(d6t_flow_t* f);
+void d6t_flow_upsample(const int16_t* src, int n_row, int16_t* dst);
+int d6t_flow_update(d6t_flow_t* f, const int16_t* pix);
+int d6t_flow_roi(const d6t_flow_t* f, const d6t_roi_t* roi,
+                 int32_t* vx, int32_t* vy);
+int d6t_flow_sprint_field(const d6t_flow_t* f, char* buf, size_t len);
+int d6t_flow_sprint_roi(const d6t_flow_t* f, const d6t_roi_t* roi,
+                        char* buf, size_t len);
+
+#endif  // D6T_FLOW_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
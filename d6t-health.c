@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include "d6t-health.h"
+#include "d6t-phase.h"
+
+/** <!-- d6t_health_init {{{1 --> setup the monitor with the defaults.
+ * PTAT in -20 to 80 degC, 3 PEC failures, 3 PTAT errors in a row or
+ * identical data for 10 s re-initialize the sensor. a stable scene
+ * repeats the data of a few pixels, so the time is 16 / n_pixel times
+ * as long below 16 pixels (160 s for D6T-1A).
+ */
+void d6t_health_init(d6t_health_t* h, int n_pixel) {
+    *h = (d6t_health_t){0};
+    h->pec_limit = 3;
+    h->range_limit = 3;
+    h->stuck_ns = 10000000000LL;
+    if (n_pixel > 0 && n_pixel < 16) {
+        h->stuck_ns = h->stuck_ns * 16 / n_pixel;
+    }
+    h->ptat_min = -200;
+    h->ptat_max = 800;
+}
+
+/** <!-- d6t_health_check {{{1 --> check a read frame.
+ * buf is the read buffer (PTAT at 0), now_ns the read time.
+ * returns D6T_HEALTH_OK, D6T_HEALTH_BAD for a frame to be dropped,
+ * D6T_HEALTH_REINIT if the sensor should be initialized again, or
+ * D6T_HEALTH_RECOVERED for the first valid frame after that.
+ * the recovery time is from the first invalid frame of the fault
+ * (or its detection for stuck data) to the first valid frame.
+ * the stuck data is timed, not counted, as the read interval varies and
+ * the phase-locked polling reads the repeated frames on purpose.
+ * a repeated frame is valid until stuck_ns, also while recovering.
+ */
+int d6t_health_check(d6t_health_t* h, const uint8_t* buf, int n,
+                     bool pec_ok, int64_t now_ns) {
+    uint32_t hash = d6t_phase_hash(buf, n);
+    int16_t ptat = (int16_t)((uint16_t)buf[0] | ((uint16_t)buf[1] << 8));
+    bool range_ok = ptat >= h->ptat_min && ptat <= h->ptat_max;
+    const char* fault = NULL;
+
+    h->n_pec = pec_ok ? 0 : h->n_pec + 1;
+    h->n_range = !pec_ok || range_ok ? 0 : h->n_range + 1;
+    if (!h->have_hash || hash != h->hash) {
+        h->same_ns = now_ns;
+    }
+    h->hash = hash;
+    h->have_hash = true;
+
+    if (h->n_pec >= h->pec_limit) {
+        fault = "PEC failures";
+    } else if (h->n_range >= h->range_limit) {
+        fault = "PTAT out of range";
+    } else if (now_ns - h->same_ns >= h->stuck_ns) {
+        fault = "stuck data";
+    }
+    if (fault != NULL) {
+        if (!h->recovering) {
+            h->recovering = true;
+            h->fault_ns = h->bad_ns > 0 ? h->bad_ns : now_ns;
+        }
+        h->reason = fault;
+        h->n_reinit++;
+        h->n_pec = h->n_range = 0;
+        h->same_ns = now_ns;
+        return D6T_HEALTH_REINIT;
+    }
+    if (!pec_ok || !range_ok) {
+        h->bad_ns = h->bad_ns > 0 ? h->bad_ns : now_ns;
+        return D6T_HEALTH_BAD;
+    }
+    h->bad_ns = 0;
+    if (h->recovering) {
+        h->recovering = false;
+        h->recover_ns = now_ns - h->fault_ns;
+        h->recover_sum_ns += h->recover_ns;
+        h->recover_max_ns = h->recover_ns > h->recover_max_ns ?
+                            h->recover_ns : h->recover_max_ns;
+        h->n_recover++;
+        return D6T_HEALTH_RECOVERED;
+    }
+    return D6T_HEALTH_OK;
+}
+
+/** <!-- d6t_health_report {{{1 --> print the re-init and recovery counts.
+ */
+void d6t_health_report(const d6t_health_t* h, FILE* fp) {
+    fprintf(fp, "health: %s, re-init %ld, recovered %ld, "
+            "recovery last %.1f mean %.1f max %.1f [ms]\n",
+            h->reason == NULL ? "no fault" : h->reason,
+            h->n_reinit, h->n_recover, h->recover_ns / 1e6,
+            h->n_recover > 0 ? h->recover_sum_ns / 1e6 / h->n_recover : 0.0,
+            h->recover_max_ns / 1e6);
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_HEALTH_H_
+#define D6T_HEALTH_H_
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* defines */
+#define D6T_HEALTH_OK 0       // a valid frame
+#define D6T_HEALTH_BAD 1      // an invalid frame, not to be output
+#define D6T_HEALTH_REINIT 2   // the sensor must be re-initialized
+#define D6T_HEALTH_RECOVERED 3  // the first valid frame after re-init
+
+/** <!-- d6t_health_t {{{1 --> health monitor of a sensor.
+ * watches PEC failures, PTAT out of range and stuck (identical) data,
+ * each monitor has its own state so other sensors are not affected.
+ */
+typedef struct d6t_health {
+    int pec_limit;      // PEC failures in a row to re-initialize
+    int range_limit;    // PTAT out of range in a row to re-initialize
+    int64_t stuck_ns;   // time of identical data to re-initialize
+    int16_t ptat_min, ptat_max;     // PTAT sanity range (0.1 degC)
+    int n_pec, n_range;
+    uint32_t hash;
+    int64_t same_ns;        // first read of the current data
+    bool have_hash;
+    const char* reason;     // the last fault
+    bool recovering;
+    int64_t bad_ns;         // first invalid frame of the current run
+    int64_t fault_ns;
+    long n_reinit, n_recover;
+    int64_t recover_ns, recover_sum_ns, recover_max_ns;
+} d6t_health_t;
+
+void d6t_health_init(d6t_health_t* h, int n_pixel);
+int d6t_health_check(d6t_health_t* h, const uint8_t* buf, int n,
+                     bool pec_ok, int64_t now_ns);
+void d6t_health_report(const d6t_health_t* h, FILE* fp);
+
+#endif  // D6T_HEALTH_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
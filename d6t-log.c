@@ -0,0 +1,339 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#define _GNU_SOURCE  // fopencookie()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/uio.h>
+#include "d6t-log.h"
+
+volatile sig_atomic_t d6t_log_stopping;
+
+/** <!-- now_ns {{{1 --> monotonic clock in nanoseconds.
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** <!-- next {{{1 --> the buffer after i in the ring.
+ */
+static int next(int i) {
+    return (i + 1) % D6T_LOG_N_BUF;
+}
+
+/** <!-- write_group {{{1 --> write and sync the buffers tail to head.
+ * called by the writer without the lock, the buffers are not touched
+ * by the appending side until the tail is moved.
+ */
+static int write_group(d6t_log_t* l, int tail, int head) {
+    struct iovec iov[D6T_LOG_N_BUF];
+    int n = 0, i;
+    size_t len = 0;
+
+    for (i = tail; i != head; i = next(i)) {
+        iov[n].iov_base = l->buf[i];
+        iov[n].iov_len = l->fill[i];
+        len += l->fill[i];
+        n++;
+    }
+    int64_t t0 = now_ns();
+    struct iovec* v = iov;
+    while (n > 0) {
+        ssize_t r = writev(l->fd, v, n);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        l->n_write++;
+        while (n > 0 && (size_t)r >= v->iov_len) {  // skip written iovecs.
+            r -= v->iov_len;
+            v++;
+            n--;
+        }
+        if (n > 0) {
+            v->iov_base = (uint8_t*)v->iov_base + r;
+            v->iov_len -= r;
+        }
+    }
+    if (l->sync != D6T_LOG_SYNC_NONE) {
+        int r = l->sync == D6T_LOG_SYNC_DATA ? fdatasync(l->fd) : fsync(l->fd);
+        if (r < 0) {
+            return errno;
+        }
+        l->n_sync++;
+    }
+    l->lat_ns[l->n_lat++ % D6T_LOG_N_LAT] = now_ns() - t0;
+    // a partial page is written again by the next group.
+    l->pages += (l->offset + len + D6T_LOG_PAGE - 1) / D6T_LOG_PAGE -
+                l->offset / D6T_LOG_PAGE;
+    l->offset += len;
+    return 0;
+}
+
+/** <!-- writer {{{1 --> the writer thread.
+ * hands over the filling buffer if it is older than the flush interval,
+ * writes the handed buffers as a group and frees them.
+ */
+static void* writer(void* arg) {
+    d6t_log_t* l = arg;
+
+    pthread_mutex_lock(&l->lock);
+    for (;;) {
+        int64_t now = now_ns();
+        if (l->fill[l->head] > 0 && next(l->head) != l->tail &&
+            (l->stop || now - l->first_ns[l->head] >= l->flush_ns)) {
+            l->head = next(l->head);
+        }
+        if (l->tail == l->head) {
+            if (l->stop) {
+                break;
+            }
+            int64_t due = now + l->flush_ns;
+            if (l->fill[l->head] > 0) {
+                due = l->first_ns[l->head] + l->flush_ns;
+            }
+            struct timespec ts = {
+                (time_t)(due / 1000000000), (long)(due % 1000000000)
+            };
+            pthread_cond_timedwait(&l->work, &l->lock, &ts);
+            continue;
+        }
+        int tail = l->tail, head = l->head, i;
+        pthread_mutex_unlock(&l->lock);
+        int err = write_group(l, tail, head);
+        pthread_mutex_lock(&l->lock);
+        if (err != 0 && l->error == 0) {
+            l->error = err;  // reported at the close, the data is dropped.
+        }
+        for (i = tail; i != head; i = next(i)) {
+            l->fill[i] = 0;
+        }
+        l->tail = head;
+        pthread_cond_signal(&l->space);
+    }
+    pthread_mutex_unlock(&l->lock);
+    return NULL;
+}
+
+/** <!-- d6t_log_open {{{1 --> create the log file and start the writer.
+ * flush_ms is the longest time of the output in the buffers,
+ * sync is "none" (default for NULL), "data" or "full".
+ */
+int d6t_log_open(d6t_log_t* l, const char* path, int flush_ms,
+                 const char* sync) {
+    int i;
+
+    memset(l, 0, sizeof(*l));
+    if (sync == NULL || strcmp(sync, "none") == 0) {
+        l->sync = D6T_LOG_SYNC_NONE;
+    } else if (strcmp(sync, "data") == 0) {
+        l->sync = D6T_LOG_SYNC_DATA;
+    } else if (strcmp(sync, "full") == 0) {
+        l->sync = D6T_LOG_SYNC_FULL;
+    } else {
+        fprintf(stderr, "unknown sync: %s (none, data or full)\n", sync);
+        return -1;
+    }
+    l->flush_ns = (int64_t)(flush_ms > 0 ? flush_ms : 1) * 1000000;
+    l->fd = -1;
+    for (i = 0; i < D6T_LOG_N_BUF; i++) {
+        void* p;
+        if (posix_memalign(&p, D6T_LOG_PAGE, D6T_LOG_BUF_SIZE) != 0) {
+            fprintf(stderr, "out of memory\n");
+            goto fail;
+        }
+        l->buf[i] = p;
+    }
+    l->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (l->fd < 0) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        goto fail;
+    }
+    pthread_condattr_t attr;  // the flush timer is on CLOCK_MONOTONIC.
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->work, &attr);
+    pthread_cond_init(&l->space, NULL);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&l->thread, NULL, writer, l) != 0) {
+        fprintf(stderr, "Failed to start the writer\n");
+        pthread_cond_destroy(&l->space);
+        pthread_cond_destroy(&l->work);
+        pthread_mutex_destroy(&l->lock);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    if (l->fd >= 0) {
+        close(l->fd);
+    }
+    for (i = 0; i < D6T_LOG_N_BUF; i++) {
+        free(l->buf[i]);
+        l->buf[i] = NULL;
+    }
+    return -1;
+}
+
+/** <!-- d6t_log_write {{{1 --> append to the log.
+ * copies the data to the buffers, waits only if no buffer is free.
+ * returns 0, or -1 after a failed write of the writer.
+ */
+int d6t_log_write(d6t_log_t* l, const void* data, size_t len) {
+    const uint8_t* p = data;
+
+    pthread_mutex_lock(&l->lock);
+    while (len > 0) {
+        int h = l->head;
+        if (l->fill[h] >= D6T_LOG_BUF_SIZE) {  // hand over the full buffer.
+            if (next(h) == l->tail) {
+                int64_t t0 = now_ns();
+                while (next(l->head) == l->tail) {
+                    pthread_cond_wait(&l->space, &l->lock);
+                }
+                int64_t dt = now_ns() - t0;
+                l->n_stall++;
+                l->stall_ns += dt;
+                l->stall_max_ns = dt > l->stall_max_ns ? dt : l->stall_max_ns;
+                continue;  // the writer may have handed it over.
+            }
+            l->head = next(h);
+            pthread_cond_signal(&l->work);
+            continue;
+        }
+        if (l->fill[h] == 0) {
+            l->first_ns[h] = now_ns();
+        }
+        size_t n = D6T_LOG_BUF_SIZE - l->fill[h];
+        n = n < len ? n : len;
+        memcpy(l->buf[h] + l->fill[h], p, n);
+        l->fill[h] += n;
+        p += n;
+        len -= n;
+    }
+    int err = l->error;
+    pthread_mutex_unlock(&l->lock);
+    return err != 0 ? -1 : 0;
+}
+
+/** <!-- cookie_write {{{1 --> stdio stream to the log.
+ */
+static ssize_t cookie_write(void* cookie, const char* buf, size_t size) {
+    return d6t_log_write(cookie, buf, size) ? -1 : (ssize_t)size;
+}
+
+/** <!-- d6t_log_fopen {{{1 --> a line buffered stdio stream to the log.
+ * a line (frame) is appended by a write, close it before d6t_log_close().
+ */
+FILE* d6t_log_fopen(d6t_log_t* l) {
+    static const cookie_io_functions_t funcs = {
+        .read = NULL, .write = cookie_write, .seek = NULL, .close = NULL,
+    };
+    FILE* fp = fopencookie(l, "w", funcs);
+    if (fp != NULL) {  // a 32L frame line in a buffer.
+        setvbuf(fp, NULL, _IOLBF, D6T_LOG_BUF_SIZE / 4);
+    }
+    return fp;
+}
+
+/** <!-- d6t_log_close {{{1 --> write out the buffers and stop the writer.
+ */
+void d6t_log_close(d6t_log_t* l) {
+    int i;
+
+    pthread_mutex_lock(&l->lock);
+    l->stop = true;
+    pthread_cond_signal(&l->work);
+    pthread_mutex_unlock(&l->lock);
+    pthread_join(l->thread, NULL);
+    pthread_cond_destroy(&l->space);
+    pthread_cond_destroy(&l->work);
+    pthread_mutex_destroy(&l->lock);
+    close(l->fd);
+    for (i = 0; i < D6T_LOG_N_BUF; i++) {
+        free(l->buf[i]);
+    }
+}
+
+/** <!-- compare {{{1 --> qsort() order of the latencies.
+ */
+static int compare(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/** <!-- d6t_log_report {{{1 --> print the write statistics.
+ * the write amplification is the pages written for the logged bytes,
+ * the latency percentiles are for the write and sync of the groups.
+ */
+void d6t_log_report(const d6t_log_t* l, FILE* fp) {
+    static int64_t lat[D6T_LOG_N_LAT];
+    long n = l->n_lat < D6T_LOG_N_LAT ? l->n_lat : D6T_LOG_N_LAT;
+
+    memcpy(lat, l->lat_ns, n * sizeof(int64_t));
+    qsort(lat, n, sizeof(int64_t), compare);
+#define D6T_LOG_PCT(p) (n > 0 ? (double)lat[(n - 1) * (p) / 1000] / 1e6 : 0.0)
+    fprintf(fp, "log: %lld bytes, writes %ld, syncs %ld, write amplification"
+            " %.2f\n", (long long)l->offset, l->n_write, l->n_sync,
+            l->offset > 0 ? (double)l->pages * D6T_LOG_PAGE / l->offset : 0.0);
+    fprintf(fp, "log: latency p50 %.2f p99 %.2f p99.9 %.2f max %.2f [ms]\n",
+            D6T_LOG_PCT(500), D6T_LOG_PCT(990), D6T_LOG_PCT(999),
+            D6T_LOG_PCT(1000));
+#undef D6T_LOG_PCT
+    fprintf(fp, "log: stalls %ld, stalled %.2f max %.2f [ms]%s%s\n",
+            l->n_stall, (double)l->stall_ns / 1e6,
+            (double)l->stall_max_ns / 1e6,
+            l->error != 0 ? ", error: " : "",
+            l->error != 0 ? strerror(l->error) : "");
+}
+
+/** <!-- on_signal {{{1 --> stop request by SIGINT or SIGTERM.
+ */
+static void on_signal(int sig) {
+    (void)sig;
+    d6t_log_stopping = 1;
+}
+
+/** <!-- d6t_log_trap {{{1 --> let SIGINT and SIGTERM end the main loop.
+ * the samples check d6t_log_stopping to close the log before exit.
+ */
+void d6t_log_trap(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
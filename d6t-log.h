@@ -0,0 +1,92 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_LOG_H_
+#define D6T_LOG_H_
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <signal.h>
+#include <pthread.h>
+
+/* defines */
+#define D6T_LOG_PAGE 4096
+#define D6T_LOG_BUF_SIZE (16 * D6T_LOG_PAGE)  // a write unit
+#define D6T_LOG_N_BUF 8
+#define D6T_LOG_N_LAT 4096  // write latencies kept for the percentiles
+
+typedef enum d6t_log_sync {
+    D6T_LOG_SYNC_NONE = 0,  // write only, the kernel writes back later
+    D6T_LOG_SYNC_DATA,      // fdatasync() after each group of writes
+    D6T_LOG_SYNC_FULL,      // fsync() after each group of writes
+} d6t_log_sync_t;
+
+/** <!-- d6t_log_t {{{1 --> a log file written by a writer thread.
+ * the output is appended to 64 KiB buffers, a full buffer or a buffer
+ * older than the flush interval is handed to the writer thread, which
+ * writes all the handed buffers at once and syncs them together.
+ * the writes are not aligned to the file pages, a flush by the interval
+ * writes a partial buffer and the next write starts in the same page.
+ * the appending side never waits for the disk, unless all the buffers
+ * are waiting to be written (a stall).
+ */
+typedef struct d6t_log {
+    int fd;
+    d6t_log_sync_t sync;
+    int64_t flush_ns;
+    bool stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;    // buffers handed or stop, to the writer
+    pthread_cond_t space;   // buffers written, to the appending side
+    int head;               // buffer being filled
+    int tail;               // oldest buffer not written yet
+    uint8_t* buf[D6T_LOG_N_BUF];
+    size_t fill[D6T_LOG_N_BUF];
+    int64_t first_ns[D6T_LOG_N_BUF];  // first append to the buffer
+    /* statistics */
+    int64_t offset;         // bytes written to the file
+    long long pages;        // pages touched by the writes
+    long n_write, n_sync;
+    long n_stall;           // appends waited for a free buffer
+    int64_t stall_ns, stall_max_ns;
+    int64_t lat_ns[D6T_LOG_N_LAT];  // write and sync time of the groups
+    long n_lat;
+    int error;              // errno of a failed write or sync
+} d6t_log_t;
+
+extern volatile sig_atomic_t d6t_log_stopping;
+
+int d6t_log_open(d6t_log_t* l, const char* path, int flush_ms,
+                 const char* sync);
+int d6t_log_write(d6t_log_t* l, const void* data, size_t len);
+FILE* d6t_log_fopen(d6t_log_t* l);
+void d6t_log_close(d6t_log_t* l);
+void d6t_log_report(const d6t_log_t* l, FILE* fp);
+void d6t_log_trap(void);
+
+#endif  // D6T_LOG_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,193 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <time.h>
+#include "d6t-phase.h"
+
+/* defines */
+#define PROBE_DIV 16    // retry step after a duplicate, period / 16
+#define MARGIN_DIV 32   // read margin after the refresh, period / 32
+#define CREEP_DIV 64    // phase creep to find the refresh edge, period / 64
+#define KNOWN_FRAMES 8  // frames the phase is trusted after a tight bracket
+
+/** <!-- d6t_phase_init {{{1 --> setup the tracker.
+ * nominal_ms is the fixed delay used while not locked.
+ */
+void d6t_phase_init(d6t_phase_t* p, int nominal_ms, bool locked) {
+    *p = (d6t_phase_t){0};
+    p->locked = locked;
+    p->nominal_ms = nominal_ms;
+}
+
+/** <!-- d6t_phase_hash {{{1 --> 32bit FNV-1a hash of the read data.
+ * a repeated frame has the same hash, also used by the health monitor
+ * so both agree on the repeated frames.
+ */
+uint32_t d6t_phase_hash(const uint8_t* buf, int n) {
+    int i;
+    uint32_t h = 2166136261u;
+    for (i = 0; i < n; i++) {
+        h = (h ^ buf[i]) * 16777619u;
+    }
+    return h;
+}
+
+/** <!-- periods {{{1 --> number of refresh periods in dt, rounded.
+ */
+static int64_t periods(const d6t_phase_t* p, int64_t dt) {
+    return (dt + (dt < 0 ? -p->period_ns : p->period_ns) / 2) / p->period_ns;
+}
+
+/** <!-- d6t_phase_update {{{1 --> account a read and schedule the next.
+ * read_ns is the acquisition time of the data (CLOCK_MONOTONIC).
+ * the refresh of a new frame is in (previous read, read_ns],
+ * a tight bracket (after a duplicate) gives the refresh phase and the
+ * period over a growing baseline. other new frames are predicted from
+ * the phase, and pull it earlier if they prove it late.
+ * the reads creep earlier until a duplicate shows the refresh again.
+ * returns true for a new frame, false for a duplicate.
+ */
+bool d6t_phase_update(d6t_phase_t* p, const uint8_t* buf, int n,
+                      int64_t read_ns) {
+    uint32_t h = d6t_phase_hash(buf, n);
+    bool fresh = !p->have_hash || h != p->hash;
+    int64_t lo = p->last_read_ns, est, k;
+    int64_t probe = p->period_ns > 0 ? p->period_ns / PROBE_DIV
+                                     : (int64_t)p->nominal_ms * 1000000 /
+                                       PROBE_DIV;
+    bool known;
+
+    p->hash = h;
+    p->have_hash = true;
+    p->last_read_ns = read_ns;
+    if (!fresh) {
+        p->n_dup++;
+        p->next_ns = read_ns + probe;
+        return false;
+    }
+    if (p->n_new++ < 1) {  // the first frame has no refresh bracket.
+        p->next_ns = read_ns + probe;
+        return true;
+    }
+
+    if (p->period_ns == 0 || read_ns - lo <= p->period_ns / 8) {
+        est = lo + (read_ns - lo) / 2;
+        if (p->period_ns == 0 && p->edge_ns > 0) {
+            p->period_ns = est - p->edge_ns;
+            p->anchor_ns = p->edge_ns;
+            p->anchor_k = 1;
+        } else if (p->period_ns > 0) {
+            p->anchor_k += periods(p, est - p->edge_ns);
+            if (p->anchor_k > 0) {  // 0 just after the re-anchor.
+                p->period_ns = (est - p->anchor_ns) / p->anchor_k;
+            }
+            if (p->anchor_k >= 256) {  // follow slow drifts of the sensor.
+                p->anchor_ns = est;
+                p->anchor_k = 0;
+            }
+        }
+        p->edge_ns = est;
+        p->since_edge = 0;
+    } else {
+        k = periods(p, read_ns - p->edge_ns);
+        est = p->edge_ns + k * p->period_ns;
+        if (est > read_ns) {  // the refresh was earlier than predicted.
+            p->edge_ns -= est - read_ns;
+            est = read_ns;
+        }
+        est = est < lo ? lo : est;
+        p->since_edge++;
+    }
+    p->avail_ns = est;
+    // without a recent tight bracket the phase is unknown, the expected
+    // age is half of the bracket (e.g. the fixed-delay polling), which is
+    // a guess and kept apart from the measured age.
+    known = p->since_edge <= KNOWN_FRAMES;
+    if (p->n_new > 3 && known) {
+        int64_t age = read_ns - est;
+        p->age_sum_ns += age;
+        p->age_max_ns = age > p->age_max_ns ? age : p->age_max_ns;
+        p->n_age++;
+    } else if (p->n_new > 3) {
+        p->guess_sum_ns += (read_ns - lo) / 2;
+        p->n_guess++;
+    }
+
+    if (p->period_ns > 0) {
+        k = periods(p, est - p->edge_ns) + 1;
+        p->next_ns = p->edge_ns + k * p->period_ns +
+                     p->period_ns / MARGIN_DIV -
+                     p->since_edge * (p->period_ns / CREEP_DIV);
+    } else {
+        p->next_ns = read_ns + probe;
+    }
+    if (p->next_ns < read_ns + probe) {
+        p->next_ns = read_ns + probe;
+    }
+    return true;
+}
+
+/** <!-- d6t_phase_skip {{{1 --> schedule the next read after a dropped one.
+ * the data of a dropped read (e.g. by the health monitor) is not used
+ * for the refresh tracking, the next read is a period (or the fixed
+ * delay) later, so the reads are not repeated at once.
+ */
+void d6t_phase_skip(d6t_phase_t* p, int64_t read_ns) {
+    int64_t period = p->period_ns > 0 ? p->period_ns
+                                      : (int64_t)p->nominal_ms * 1000000;
+    p->next_ns = read_ns + period;
+}
+
+/** <!-- d6t_phase_wait {{{1 --> sleep until the next read.
+ * the fixed delay of the sample if not locked.
+ */
+void d6t_phase_wait(const d6t_phase_t* p) {
+    struct timespec ts;
+    if (!p->locked || p->next_ns == 0) {
+        ts.tv_sec = p->nominal_ms / 1000;
+        ts.tv_nsec = (p->nominal_ms % 1000) * 1000000;
+        nanosleep(&ts, NULL);
+        return;
+    }
+    ts.tv_sec = (time_t)(p->next_ns / 1000000000);
+    ts.tv_nsec = (long)(p->next_ns % 1000000000);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+/** <!-- d6t_phase_report {{{1 --> print the period, duplicates and age.
+ * the age is measured for the frames after a known refresh phase,
+ * the others only have the expected age of half the read interval.
+ */
+void d6t_phase_report(const d6t_phase_t* p, FILE* fp) {
+    fprintf(fp, "%s: period %.1f [ms], new %ld, duplicates %ld, "
+            "age mean %.1f max %.1f [ms] of %ld, "
+            "unknown phase %ld (expected age %.1f [ms])\n",
+            p->locked ? "phase-locked" : "fixed-delay",
+            p->period_ns / 1e6, p->n_new, p->n_dup,
+            p->n_age > 0 ? p->age_sum_ns / 1e6 / p->n_age : 0.0,
+            p->age_max_ns / 1e6, p->n_age, p->n_guess,
+            p->n_guess > 0 ? p->guess_sum_ns / 1e6 / p->n_guess : 0.0);
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,66 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_PHASE_H_
+#define D6T_PHASE_H_
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** <!-- d6t_phase_t {{{1 --> refresh phase tracker of a sensor.
+ * a frame is new if the read data differs from the previous read,
+ * the refresh time of the sensor is estimated between the last read of
+ * the old data and the first read of the new data.
+ */
+typedef struct d6t_phase {
+    bool locked;        // schedule the reads on the refresh phase
+    int nominal_ms;     // fixed delay of the sample
+    uint32_t hash;      // hash of the last read data
+    bool have_hash;
+    int64_t last_read_ns;   // previous read time
+    int64_t next_ns;        // next scheduled read
+    int64_t avail_ns;       // estimated refresh time of the last new frame
+    int64_t edge_ns;        // refresh phase reference
+    int64_t period_ns;      // estimated refresh period, 0: not yet
+    int64_t anchor_ns;      // first tight refresh of the period baseline
+    long anchor_k;          // refresh periods since anchor_ns
+    int since_edge;         // new frames since the last tight bracket
+    long n_new, n_dup;
+    int64_t age_sum_ns, age_max_ns;   // age from a known refresh phase
+    long n_age;
+    int64_t guess_sum_ns;   // half the read interval, the phase unknown
+    long n_guess;
+} d6t_phase_t;
+
+uint32_t d6t_phase_hash(const uint8_t* buf, int n);
+void d6t_phase_init(d6t_phase_t* p, int nominal_ms, bool locked);
+bool d6t_phase_update(d6t_phase_t* p, const uint8_t* buf, int n,
+                      int64_t read_ns);
+void d6t_phase_skip(d6t_phase_t* p, int64_t read_ns);
+void d6t_phase_wait(const d6t_phase_t* p);
+void d6t_phase_report(const d6t_phase_t* p, FILE* fp);
+
+#endif  // D6T_PHASE_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <string.h>
+#include "d6t-pyramid.h"
+
+/** <!-- d6t_pyramid_init {{{1 --> initialize with no levels requested.
+ * pool is "box" (default for NULL) or "max".
+ */
+int d6t_pyramid_init(d6t_pyramid_t* p, int n_row, const char* pool) {
+    memset(p, 0, sizeof(*p));
+    if (n_row < 2 || n_row > D6T_PYRAMID_MAX_ROW) {
+        return -1;
+    }
+    p->n_row = n_row;
+    if (pool == NULL || strcmp(pool, "box") == 0) {
+        p->pool = D6T_POOL_BOX;
+    } else if (strcmp(pool, "max") == 0) {
+        p->pool = D6T_POOL_MAX;
+    } else {
+        fprintf(stderr, "unknown pooling: %s (box or max)\n", pool);
+        return -1;
+    }
+    return 0;
+}
+
+/** <!-- d6t_pyramid_request {{{1 --> request a level by its rows.
+ * returns the level index into p->lvl, or -1 if the frame can not
+ * be decimated to the rows.
+ */
+int d6t_pyramid_request(d6t_pyramid_t* p, int rows) {
+    int k;
+    for (k = 0; k < D6T_PYRAMID_MAX_LEVEL; k++) {
+        int div = 2 << k;
+        if (p->n_row % div == 0 && p->n_row / div == rows) {
+            p->depth = k + 1 > p->depth ? k + 1 : p->depth;
+            return k;
+        }
+    }
+    fprintf(stderr, "can not decimate %d rows to %d\n", p->n_row, rows);
+    return -1;
+}
+
+/** <!-- pool_row16 {{{1 --> pool a pair of frame rows to a level row.
+ * the loops have no branches on the data to be vectorized by gcc.
+ */
+static void pool_row16(d6t_pool_t pool, const int16_t* a, const int16_t* b,
+                       int n, int32_t* out) {
+    int x;
+    if (pool == D6T_POOL_MAX) {
+        for (x = 0; x < n / 2; x++) {
+            int32_t u = a[2 * x] > a[2 * x + 1] ? a[2 * x] : a[2 * x + 1];
+            int32_t v = b[2 * x] > b[2 * x + 1] ? b[2 * x] : b[2 * x + 1];
+            out[x] = u > v ? u : v;
+        }
+        return;
+    }
+    for (x = 0; x < n / 2; x++) {
+        out[x] = (int32_t)a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1];
+    }
+}
+
+/** <!-- pool_row32 {{{1 --> pool a pair of level rows to the next level.
+ */
+static void pool_row32(d6t_pool_t pool, const int32_t* a, const int32_t* b,
+                       int n, int32_t* out) {
+    int x;
+    if (pool == D6T_POOL_MAX) {
+        for (x = 0; x < n / 2; x++) {
+            int32_t u = a[2 * x] > a[2 * x + 1] ? a[2 * x] : a[2 * x + 1];
+            int32_t v = b[2 * x] > b[2 * x + 1] ? b[2 * x] : b[2 * x + 1];
+            out[x] = u > v ? u : v;
+        }
+        return;
+    }
+    for (x = 0; x < n / 2; x++) {
+        out[x] = a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1];
+    }
+}
+
+/** <!-- d6t_pyramid_build {{{1 --> build the requested levels of a frame.
+ * walks the frame once by row pairs, a row of a deeper level is pooled
+ * as soon as its two source rows are done, while they are still in cache.
+ * pix is in raw units, the levels are in p->lvl[k].
+ */
+void d6t_pyramid_build(d6t_pyramid_t* p, const int16_t* pix) {
+    int y, k, i;
+    int n = p->n_row;
+
+    for (y = 0; y < n / 2 && p->depth > 0; y++) {
+        const int16_t* src = pix + 2 * y * n;
+        pool_row16(p->pool, src, src + n, n, p->acc[0] + y * (n / 2));
+        for (k = 1; k < p->depth && ((y + 1) & ((1 << k) - 1)) == 0; k++) {
+            int m = n >> k;  // columns of the level k - 1
+            const int32_t* s = p->acc[k - 1] + (((y + 1) >> (k - 1)) - 2) * m;
+            pool_row32(p->pool, s, s + m, m,
+                       p->acc[k] + (((y + 1) >> k) - 1) * (m / 2));
+        }
+    }
+    for (k = 0; k < p->depth; k++) {
+        int n_pix = (n >> (k + 1)) * (n >> (k + 1));
+        int shift = 2 * (k + 1);  // a box sum of 4^(k+1) pixels
+        const int32_t* s = p->acc[k];
+        int16_t* out = p->lvl[k];
+        if (p->pool == D6T_POOL_MAX) {
+            for (i = 0; i < n_pix; i++) {
+                out[i] = (int16_t)s[i];
+            }
+            continue;
+        }
+        for (i = 0; i < n_pix; i++) {
+            out[i] = (int16_t)((s[i] + (1 << (shift - 1))) >> shift);
+        }
+    }
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
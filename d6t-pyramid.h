@@ -0,0 +1,60 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_PYRAMID_H_
+#define D6T_PYRAMID_H_
+
+/* includes */
+#include <stdint.h>
+
+/* defines */
+#define D6T_PYRAMID_MAX_ROW 32
+#define D6T_PYRAMID_MAX_LEVEL 3  // 16x16, 8x8 and 4x4 of a 32x32 frame
+#define D6T_PYRAMID_MAX_PIXEL \
+    ((D6T_PYRAMID_MAX_ROW / 2) * (D6T_PYRAMID_MAX_ROW / 2))
+
+typedef enum d6t_pool {
+    D6T_POOL_BOX = 0,   // mean of the 2x2 block, rounded
+    D6T_POOL_MAX,       // maximum of the 2x2 block
+} d6t_pool_t;
+
+/** <!-- d6t_pyramid_t {{{1 --> decimated levels of a square frame.
+ * level k (0-based) has n_row >> (k + 1) rows, the levels are built in
+ * one pass over the frame down to the deepest requested level.
+ * box levels keep the exact block sums, so a deep level is the rounded
+ * mean of its whole block, not a mean of rounded means.
+ */
+typedef struct d6t_pyramid {
+    d6t_pool_t pool;
+    int n_row;          // rows (= columns) of the base frame
+    int depth;          // number of levels to build
+    int32_t acc[D6T_PYRAMID_MAX_LEVEL][D6T_PYRAMID_MAX_PIXEL];  // sum/max
+    int16_t lvl[D6T_PYRAMID_MAX_LEVEL][D6T_PYRAMID_MAX_PIXEL];  // raw units
+} d6t_pyramid_t;
+
+int d6t_pyramid_init(d6t_pyramid_t* p, int n_row, const char* pool);
+int d6t_pyramid_request(d6t_pyramid_t* p, int rows);
+void d6t_pyramid_build(d6t_pyramid_t* p, const int16_t* pix);
+
+#endif  // D6T_PYRAMID_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
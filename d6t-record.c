@@ -0,0 +1,224 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "d6t-record.h"
+#include "d6t-stamp.h"
+#include "d6t-text.h"
+
+/** <!-- d6t_record_parse {{{1 --> read a frame from an output line.
+ * the pixel number is taken from the line, the timestamp from a `-T`
+ * prefix if any. the sensor number is left to the caller.
+ * returns 0, or -1 if the line is not a full frame line.
+ */
+int d6t_record_parse(d6t_record_t* r, const char* line) {
+    int32_t dur;
+    int n = 0;
+    const char* p = strstr(line, "PTAT:");
+
+    if (p == NULL) {
+        return -1;
+    }
+    p += 5;
+    if (d6t_text_parse_value(&p, &r->ptat) ||
+        strncmp(p, "[degC]", 6) != 0 ||
+        (p = strstr(p, "Temperature:")) == NULL) {
+        return -1;
+    }
+    for (p += 12; *p == ' '; p++) {}
+    while (*p != '[' && n < D6T_RECORD_MAX_PIXEL) {
+        if (d6t_text_parse_value(&p, &r->pix[n])) {
+            return -1;
+        }
+        n++;
+    }
+    if (n < 1 || *p != '[') {
+        return -1;
+    }
+    r->n_pixel = (uint16_t)n;
+    if (d6t_stamp_parse(line, &r->ts_ns, &dur)) {
+        r->ts_ns = 0;
+    }
+    return 0;
+}
+
+/** <!-- put_value {{{1 --> format raw units as `%4.1f, ` does.
+ * the raw value has one decimal, so the integer formatting gives the
+ * same text as printf without its cost.
+ */
+static char* put_value(char* p, int16_t v) {
+    char tmp[8];
+    int n = 0;
+    int a = v < 0 ? -v : v;
+
+    tmp[n++] = (char)('0' + a % 10);
+    tmp[n++] = '.';
+    a /= 10;
+    do {
+        tmp[n++] = (char)('0' + a % 10);
+        a /= 10;
+    } while (a > 0);
+    if (v < 0) {
+        tmp[n++] = '-';
+    }
+    for (; n < 4; n++) {
+        tmp[n] = ' ';
+    }
+    while (n > 0) {
+        *p++ = tmp[--n];
+    }
+    *p++ = ',';
+    *p++ = ' ';
+    return p;
+}
+
+/** <!-- d6t_record_sprint {{{1 --> format a frame as an output line.
+ * returns the line length, or -1 if the buffer is too short.
+ */
+int d6t_record_sprint(const d6t_record_t* r, char* buf, size_t len) {
+    int i;
+    char* p = buf;
+
+    // "PTAT: " + 9 characters at most per value + "[degC], ..." + "[degC]\n"
+    if (len < (size_t)(r->n_pixel + 1) * 9 + 40) {
+        return -1;
+    }
+    memcpy(p, "PTAT: ", 6);
+    p = put_value(p + 6, r->ptat) - 2;
+    memcpy(p, " [degC], Temperature: ", 22);
+    p += 22;
+    for (i = 0; i < r->n_pixel; i++) {
+        p = put_value(p, r->pix[i]);
+    }
+    memcpy(p, "[degC]\n", 8);
+    return (int)(p + 7 - buf);
+}
+
+/** <!-- put16/get16 {{{1 --> little-endian 16 bit fields.
+ */
+static void put16(uint8_t* buf, uint16_t v) {
+    buf[0] = (uint8_t)(v & 0xFF);
+    buf[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get16(const uint8_t* buf) {
+    return (uint16_t)(buf[0] | buf[1] << 8);
+}
+
+/** <!-- d6t_record_pack {{{1 --> encode a binary record.
+ * buf must hold D6T_RECORD_MAX_SIZE bytes, returns the record size.
+ */
+size_t d6t_record_pack(const d6t_record_t* r, uint8_t* buf) {
+    int i;
+    uint64_t ts = (uint64_t)r->ts_ns;
+
+    put16(buf, D6T_RECORD_MAGIC);
+    put16(buf + 2, r->n_pixel);
+    put16(buf + 4, r->sensor);
+    put16(buf + 6, (uint16_t)r->ptat);
+    for (i = 0; i < 8; i++) {
+        buf[8 + i] = (uint8_t)(ts >> (8 * i));
+    }
+    for (i = 0; i < r->n_pixel; i++) {
+        put16(buf + D6T_RECORD_HEADER + 2 * i, (uint16_t)r->pix[i]);
+    }
+    return D6T_RECORD_HEADER + 2 * (size_t)r->n_pixel;
+}
+
+/** <!-- d6t_record_unpack {{{1 --> decode a binary record.
+ * returns the record size, 0 if len is short of the record,
+ * or -1 for a broken record.
+ */
+int d6t_record_unpack(d6t_record_t* r, const uint8_t* buf, size_t len) {
+    int i;
+    uint64_t ts = 0;
+
+    if (len < D6T_RECORD_HEADER) {
+        return 0;
+    }
+    if (get16(buf) != D6T_RECORD_MAGIC ||
+        get16(buf + 2) < 1 || get16(buf + 2) > D6T_RECORD_MAX_PIXEL) {
+        return -1;
+    }
+    r->n_pixel = get16(buf + 2);
+    if (len < D6T_RECORD_HEADER + 2 * (size_t)r->n_pixel) {
+        return 0;
+    }
+    r->sensor = get16(buf + 4);
+    r->ptat = (int16_t)get16(buf + 6);
+    for (i = 7; i >= 0; i--) {
+        ts = ts << 8 | buf[8 + i];
+    }
+    r->ts_ns = (int64_t)ts;
+    for (i = 0; i < r->n_pixel; i++) {
+        r->pix[i] = (int16_t)get16(buf + D6T_RECORD_HEADER + 2 * i);
+    }
+    return D6T_RECORD_HEADER + 2 * r->n_pixel;
+}
+
+/** <!-- d6t_record_read {{{1 --> read a binary record from a stream.
+ * returns 1, 0 at the end of the stream, or -1 for a broken record.
+ */
+int d6t_record_read(d6t_record_t* r, FILE* fp) {
+    uint8_t buf[D6T_RECORD_MAX_SIZE];
+    size_t n = fread(buf, 1, D6T_RECORD_HEADER, fp);
+
+    if (n == 0) {
+        return 0;
+    }
+    if (n < D6T_RECORD_HEADER || d6t_record_unpack(r, buf, n) < 0) {
+        return -1;
+    }
+    n += fread(buf + n, 1, 2 * (size_t)get16(buf + 2), fp);
+    return d6t_record_unpack(r, buf, n) > 0 ? 1 : -1;
+}
+/** <!-- d6t_record_next {{{1 --> read the next frame of a recording.
+ * the recording is binary records or text lines, told by the magic,
+ * the text lines which are not full frames are skipped.
+ * line is a work buffer for the text, D6T_RECORD_LINE_MAX or more.
+ * returns 1, 0 at the end of the recording, or -1 for a broken record.
+ */
+int d6t_record_next(d6t_record_t* r, FILE* fp, char* line, size_t len) {
+    for (;;) {
+        int c = getc(fp);
+        if (c == EOF) {
+            return 0;
+        }
+        ungetc(c, fp);
+        if (c == (D6T_RECORD_MAGIC & 0xFF)) {
+            return d6t_record_read(r, fp);
+        }
+        if (fgets(line, (int)len, fp) == NULL) {
+            return 0;
+        }
+        if (d6t_record_parse(r, line) == 0) {
+            r->sensor = 0;
+            return 1;
+        }
+    }
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,66 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_RECORD_H_
+#define D6T_RECORD_H_
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* defines */
+#define D6T_RECORD_MAX_PIXEL (32 * 32)
+#define D6T_RECORD_MAGIC 0x7ED6     // "\xD6\x7E" at the record head
+#define D6T_RECORD_HEADER 16
+#define D6T_RECORD_MAX_SIZE (D6T_RECORD_HEADER + D6T_RECORD_MAX_PIXEL * 2)
+#define D6T_RECORD_LINE_MAX 10240
+
+/** <!-- d6t_record_t {{{1 --> a converted frame, in raw units (0.1 degC).
+ * the binary record is the 16 byte header (magic, n_pixel, sensor,
+ * PTAT as 16 bit and the timestamp as 64 bit) and the pixels as 16 bit,
+ * all little-endian.
+ */
+typedef struct d6t_record {
+    int64_t ts_ns;      // acquisition time (monotonic), 0: not stamped
+    uint16_t sensor;    // sensor (stream) number
+    uint16_t n_pixel;
+    int16_t ptat;
+    int16_t pix[D6T_RECORD_MAX_PIXEL];
+} d6t_record_t;
+
+/* text lines, the same format as the sample output */
+int d6t_record_parse(d6t_record_t* r, const char* line);
+int d6t_record_sprint(const d6t_record_t* r, char* buf, size_t len);
+
+/* binary records */
+size_t d6t_record_pack(const d6t_record_t* r, uint8_t* buf);
+int d6t_record_unpack(d6t_record_t* r, const uint8_t* buf, size_t len);
+int d6t_record_read(d6t_record_t* r, FILE* fp);
+
+/* recordings of either format */
+int d6t_record_next(d6t_record_t* r, FILE* fp, char* line, size_t len);
+
+#endif  // D6T_RECORD_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
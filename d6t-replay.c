@@ -0,0 +1,333 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "d6t-record.h"
+#include "d6t-stamp.h"
+
+/* defines */
+#define REPORT_NS 1000000000  // report the rate every second.
+
+/* recorded frames */
+static d6t_record_t* frames;
+static long n_frame, cap_frame;
+
+/** <!-- now_ns {{{1 --> monotonic clock in nanoseconds.
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** <!-- load {{{1 --> read a recording, text lines or binary records.
+ */
+static int load(FILE* fp) {
+    static char line[D6T_RECORD_LINE_MAX + 80];
+    int ret;
+
+    for (;;) {
+        if (n_frame >= cap_frame) {
+            long n = cap_frame > 0 ? cap_frame * 2 : 256;
+            d6t_record_t* p = realloc(frames, n * sizeof(d6t_record_t));
+            if (p == NULL) {
+                fprintf(stderr, "out of memory\n");
+                return -1;
+            }
+            frames = p;
+            cap_frame = n;
+        }
+        if ((ret = d6t_record_next(&frames[n_frame], fp, line,
+                                   sizeof(line))) <= 0) {
+            break;
+        }
+        n_frame++;
+    }
+    if (ret < 0) {
+        fprintf(stderr, "broken record at frame %ld\n", n_frame);
+    }
+    return ret;
+}
+
+/** <!-- open_udp {{{1 --> open a socket and resolve `host:port`.
+ */
+static int open_udp(const char* spec, struct sockaddr_storage* addr,
+                    socklen_t* addr_len) {
+    char host[256];
+    const char* port = strrchr(spec, ':');
+    struct addrinfo hints, *res;
+
+    if (port == NULL || (size_t)(port - spec) >= sizeof(host)) {
+        fprintf(stderr, "udp destination must be host:port\n");
+        return -1;
+    }
+    memcpy(host, spec, port - spec);
+    host[port - spec] = '\0';
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, port + 1, &hints, &res) != 0) {
+        fprintf(stderr, "Failed to resolve: %s\n", spec);
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    memcpy(addr, res->ai_addr, res->ai_addrlen);
+    *addr_len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return fd;
+}
+
+/** <!-- get_port {{{1 --> destination port of the first sensor.
+ */
+static int get_port(const struct sockaddr_storage* addr) {
+    if (addr->ss_family == AF_INET) {
+        return ntohs(((const struct sockaddr_in*)addr)->sin_port);
+    } else if (addr->ss_family == AF_INET6) {
+        return ntohs(((const struct sockaddr_in6*)addr)->sin6_port);
+    }
+    return 0;
+}
+
+/** <!-- set_port {{{1 --> destination port of a virtual sensor.
+ */
+static void set_port(struct sockaddr_storage* addr, int offset) {
+    if (addr->ss_family == AF_INET) {
+        struct sockaddr_in* in = (struct sockaddr_in*)addr;
+        in->sin_port = htons(ntohs(in->sin_port) + offset);
+    } else if (addr->ss_family == AF_INET6) {
+        struct sockaddr_in6* in6 = (struct sockaddr_in6*)addr;
+        in6->sin6_port = htons(ntohs(in6->sin6_port) + offset);
+    }
+}
+
+/** <!-- main - accelerated replay {{{1 -->
+ * replay recorded frames, the text output of the samples (stamped with
+ * `-T` for the recorded timing) or binary records, at the recorded speed,
+ * N times faster or as fast as possible, as several virtual sensors.
+ * the output rate is reported to stderr every second and at the end.
+ *
+ * options:
+ *   -s speed:    1: recorded timing (default), N: N times faster,
+ *                0: as fast as possible.
+ *   -i msec:     frame interval of a recording without timestamps
+ *                (default 100).
+ *   -n sensors:  virtual sensors, each frame is output for each sensor,
+ *                prefixed by `[n] ` on the text output (default 1).
+ *   -L loops:    replay the recording repeatedly, 0: forever (default 1).
+ *   -b:          output binary records instead of text lines.
+ *   -T:          prefix the text lines with the replay time, as `-T`
+ *                of the samples.
+ *   -u host:port: send each frame as a UDP datagram, the virtual sensor
+ *                n to port + n, instead of stdout.
+ */
+int main(int argc, char* argv[]) {
+    int opt, s;
+    double speed = 1.0, interval = 100.0;
+    int n_sensor = 1;
+    long loops = 1, loop, k;
+    bool binary = false, stamped = false;
+    const char* udp = NULL;
+    int fd = -1;
+    struct sockaddr_storage addr[2];
+    socklen_t addr_len = 0;
+    static char line[D6T_RECORD_LINE_MAX + 80];
+    static uint8_t rec[D6T_RECORD_MAX_SIZE];
+    char pre[16], ts[80] = "";
+    d6t_stamp_t stamp;
+    long long n_out = 0, n_late = 0, bytes = 0;
+    int64_t late_max_ns = 0;
+    long long last_out = 0, last_bytes = 0;
+
+    while ((opt = getopt(argc, argv, "s:i:n:L:bTu:")) != -1) {
+        switch (opt) {
+        case 's': speed = atof(optarg); break;
+        case 'i': interval = atof(optarg); break;
+        case 'n': n_sensor = atoi(optarg); break;
+        case 'L': loops = atol(optarg); break;
+        case 'b': binary = true; break;
+        case 'T': stamped = true; break;
+        case 'u': udp = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-s speed] [-i msec] [-n sensors]"
+                    " [-L loops] [-b] [-T] [-u host:port] [file ...]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (n_sensor < 1 || speed < 0.0 || interval <= 0.0) {
+        fprintf(stderr, "invalid speed, interval or sensors\n");
+        return 1;
+    }
+    if (optind >= argc && load(stdin) < 0) {
+        return 1;
+    }
+    for (; optind < argc; optind++) {
+        FILE* fp = fopen(argv[optind], "r");
+        if (fp == NULL) {
+            fprintf(stderr, "Failed to open: %s\n", argv[optind]);
+            return 1;
+        }
+        int ret = load(fp);
+        fclose(fp);
+        if (ret < 0) {
+            return 1;
+        }
+    }
+    if (n_frame < 1) {
+        fprintf(stderr, "no frames in input.\n");
+        return 1;
+    }
+    if (udp != NULL && (fd = open_udp(udp, &addr[0], &addr_len)) < 0) {
+        return 1;
+    }
+    if (fd >= 0 && (get_port(&addr[0]) < 1 ||
+                    get_port(&addr[0]) + n_sensor - 1 > 65535)) {
+        fprintf(stderr, "udp ports %d to %d out of 1 to 65535\n",
+                get_port(&addr[0]), get_port(&addr[0]) + n_sensor - 1);
+        close(fd);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);  // a closed reader ends the replay.
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+    // the recorded timing, or the interval if not stamped
+    bool timed = frames[0].ts_ns != 0 && frames[n_frame - 1].ts_ns != 0;
+    int64_t step_ns = (int64_t)(interval * 1e6);
+    int64_t span_ns = timed ? frames[n_frame - 1].ts_ns - frames[0].ts_ns
+                    : 0;
+    span_ns += step_ns;  // the gap from the last frame to the first.
+
+    int64_t t0 = now_ns(), last_report = t0;
+    for (loop = 0; loops == 0 || loop < loops; loop++) {
+        for (k = 0; k < n_frame; k++) {
+            d6t_record_t* r = &frames[k];
+            if (speed > 0.0) {  // sleep until the scheduled time.
+                int64_t rel = timed ? r->ts_ns - frames[0].ts_ns
+                            : k * step_ns;
+                // the deadline is the scheduled time of the next frame.
+                int64_t rel_next = k + 1 >= n_frame ? span_ns
+                                 : timed ? frames[k + 1].ts_ns - frames[0].ts_ns
+                                 : (k + 1) * step_ns;
+                int64_t due = t0 + (int64_t)((loop * span_ns + rel) / speed);
+                int64_t deadline = t0 + (int64_t)((loop * span_ns + rel_next) /
+                                                  speed);
+                int64_t now = now_ns();
+                if (due > now) {
+                    struct timespec ts_due = {
+                        (time_t)(due / 1000000000), (long)(due % 1000000000)
+                    };
+                    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                                    &ts_due, NULL);
+                } else if (now > deadline) {
+                    n_late++;  // behind the schedule by a frame.
+                    late_max_ns = now - due > late_max_ns ? now - due
+                                                          : late_max_ns;
+                }
+            }
+            int64_t ts_ns = r->ts_ns;
+            int len;
+            if (stamped) {
+                stamp.begin_ns = stamp.end_ns = now_ns();
+                d6t_stamp_sprint(&stamp, false, ts, sizeof(ts));
+                r->ts_ns = stamp.begin_ns;
+            }
+            if (binary) {
+                len = (int)d6t_record_pack(r, rec);
+            } else {
+                len = d6t_record_sprint(r, line, sizeof(line));
+            }
+            r->ts_ns = ts_ns;
+            for (s = 0; s < n_sensor; s++) {
+                if (binary) {  // the sensor field of the packed record.
+                    rec[4] = (uint8_t)(s & 0xFF);
+                    rec[5] = (uint8_t)(s >> 8);
+                }
+                if (fd >= 0) {
+                    addr[1] = addr[0];
+                    set_port(&addr[1], s);
+                    if (binary) {
+                        sendto(fd, rec, len, 0,
+                               (struct sockaddr*)&addr[1], addr_len);
+                    } else {
+                        int n = snprintf(pre, sizeof(pre), "[%d] ", s);
+                        char msg[sizeof(pre) + sizeof(ts) + sizeof(line)];
+                        n = n_sensor > 1 ? n : 0;
+                        memcpy(msg, pre, n);
+                        memcpy(msg + n, ts, strlen(ts));
+                        n += strlen(ts);
+                        memcpy(msg + n, line, len);
+                        sendto(fd, msg, n + len, 0,
+                               (struct sockaddr*)&addr[1], addr_len);
+                    }
+                } else if (binary) {
+                    fwrite(rec, 1, len, stdout);
+                } else {
+                    if (n_sensor > 1) {
+                        fprintf(stdout, "[%d] ", s);
+                    }
+                    fputs(ts, stdout);
+                    fwrite(line, 1, len, stdout);
+                }
+                n_out++;
+                bytes += len;
+            }
+            if (ferror(stdout)) {
+                fprintf(stderr, "output closed\n");
+                loops = loop + 1;
+                break;
+            }
+            int64_t now = now_ns();
+            if (now - last_report >= REPORT_NS) {
+                double sec = (double)(now - last_report) / 1e9;
+                fprintf(stderr, "replay: %.0f frames/s, %.2f MB/s,"
+                        " late %lld\n", (n_out - last_out) / sec,
+                        (bytes - last_bytes) / sec / 1e6, n_late);
+                last_report = now;
+                last_out = n_out;
+                last_bytes = bytes;
+            }
+        }
+    }
+    fflush(stdout);
+
+    double sec = (double)(now_ns() - t0) / 1e9;
+    fprintf(stderr, "replayed: %lld frames (%ld recorded x %ld loops x %d"
+            " sensors) in %.2f [s], %.0f frames/s, %.2f MB/s, late %lld"
+            " (max %.1f [ms])\n",
+            n_out, n_frame, loop, n_sensor, sec, n_out / sec,
+            bytes / sec / 1e6, n_late, late_max_ns / 1e6);
+    free(frames);
+    return 0;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
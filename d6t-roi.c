@@ -0,0 +1,151 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "d6t-roi.h"
+#include "d6t-text.h"
+
+/** <!-- parse_mask {{{1 --> read a mask file to pixel indexes.
+ * a mask file has a line per row, `1`, `#` or `x` selects the pixel.
+ */
+static int parse_mask(d6t_roi_t* roi, const char* path, int n_row) {
+    char line[256];
+    int x, y = 0;
+    FILE* fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open ROI mask: %s\n", path);
+        return -1;
+    }
+    while (y < n_row && fgets(line, sizeof(line), fp) != NULL) {
+        for (x = 0; x < n_row && line[x] != '\0' && line[x] != '\n'; x++) {
+            if (line[x] == '1' || line[x] == '#' || line[x] == 'x') {
+                roi->idx[roi->n++] = (uint16_t)(y * n_row + x);
+            }
+        }
+        y++;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/** <!-- d6t_roi_parse {{{1 --> build a ROI from the option string.
+ * `name=x,y,w,h` for a rectangle, `name=@file` for a mask file.
+ */
+int d6t_roi_parse(d6t_roi_t* roi, const char* spec, int n_row) {
+    int x, y, x0, y0, w, h;
+    const char* eq = strchr(spec, '=');
+    size_t len = eq == NULL ? 0 : (size_t)(eq - spec);
+
+    memset(roi, 0, sizeof(*roi));
+    if (len < 1 || len >= D6T_ROI_NAME) {
+        fprintf(stderr, "ROI must be name=x,y,w,h or name=@mask: %s\n", spec);
+        return -1;
+    }
+    memcpy(roi->name, spec, len);
+    if (eq[1] == '@') {
+        if (parse_mask(roi, eq + 2, n_row)) {
+            return -1;
+        }
+    } else if (sscanf(eq + 1, "%d,%d,%d,%d", &x0, &y0, &w, &h) == 4 &&
+               x0 >= 0 && y0 >= 0 && w > 0 && h > 0 &&
+               x0 + w <= n_row && y0 + h <= n_row) {
+        for (y = y0; y < y0 + h; y++) {
+            for (x = x0; x < x0 + w; x++) {
+                roi->idx[roi->n++] = (uint16_t)(y * n_row + x);
+            }
+        }
+    } else {
+        fprintf(stderr, "ROI out of %dx%d: %s\n", n_row, n_row, spec);
+        return -1;
+    }
+    if (roi->n < 1) {
+        fprintf(stderr, "ROI has no pixels: %s\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+/** <!-- d6t_roi_decode {{{1 --> convert the ROI pixels from the byte stream.
+ * only the ROI pixels are touched, buf is the whole read buffer
+ * (PTAT at 0, pixels from 2).
+ */
+void d6t_roi_decode(const d6t_roi_t* roi, const uint8_t* buf, int16_t* out) {
+    int i;
+    for (i = 0; i < roi->n; i++) {
+        const uint8_t* p = buf + 2 + 2 * roi->idx[i];
+        out[i] = (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+    }
+}
+
+/** <!-- d6t_roi_stats {{{1 --> min, max and sum of the ROI pixels.
+ */
+void d6t_roi_stats(const int16_t* vals, int n,
+                   int16_t* min, int16_t* max, int32_t* sum) {
+    int i;
+    int16_t lo = vals[0], hi = vals[0];
+    int32_t s = 0;
+    for (i = 0; i < n; i++) {
+        lo = vals[i] < lo ? vals[i] : lo;
+        hi = vals[i] > hi ? vals[i] : hi;
+        s += vals[i];
+    }
+    *min = lo;
+    *max = hi;
+    *sum = s;
+}
+
+/** <!-- d6t_roi_sprint {{{1 --> format the ROI output line.
+ * the line is prefixed by the ROI name, the pixel list follows the
+ * full frame format, the summary has min, max and mean.
+ * returns the line length, or -1 if the buffer is too short.
+ */
+int d6t_roi_sprint(const d6t_roi_t* roi, int16_t ptat, const int16_t* vals,
+                   bool summary, char* buf, size_t len) {
+    int i;
+    d6t_text_t line;
+
+    d6t_text_init(&line, buf, len);
+    d6t_text_put(&line, "%s: PTAT: %4.1f [degC], ", roi->name,
+                 (double)ptat / 10.0);
+    if (summary) {
+        int16_t min, max;
+        int32_t sum;
+        d6t_roi_stats(vals, roi->n, &min, &max, &sum);
+        d6t_text_put(&line, "Min: %4.1f, Max: %4.1f, Mean: %4.1f, ",
+                     (double)min / 10.0, (double)max / 10.0,
+                     (double)sum / roi->n / 10.0);
+    } else {
+        d6t_text_put(&line, "Temperature: ");
+        for (i = 0; i < roi->n; i++) {
+            d6t_text_put(&line, "%4.1f, ", (double)vals[i] / 10.0);
+        }
+    }
+    d6t_text_put(&line, "[degC]\n");
+    return d6t_text_end(&line);
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
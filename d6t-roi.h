@@ -0,0 +1,55 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_ROI_H_
+#define D6T_ROI_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* defines */
+#define D6T_ROI_MAX 8
+#define D6T_ROI_MAX_PIXEL (32 * 32)
+#define D6T_ROI_NAME 16
+
+/** <!-- d6t_roi_t {{{1 --> a named region of interest.
+ * the region is a list of pixel indexes in row-major order,
+ * built from a rectangle or from a mask file.
+ */
+typedef struct d6t_roi {
+    char name[D6T_ROI_NAME];
+    int n;
+    uint16_t idx[D6T_ROI_MAX_PIXEL];
+} d6t_roi_t;
+
+int d6t_roi_parse(d6t_roi_t* roi, const char* spec, int n_row);
+void d6t_roi_decode(const d6t_roi_t* roi, const uint8_t* buf, int16_t* out);
+void d6t_roi_stats(const int16_t* vals, int n,
+                   int16_t* min, int16_t* max, int32_t* sum);
+int d6t_roi_sprint(const d6t_roi_t* roi, int16_t ptat, const int16_t* vals,
+                   bool summary, char* buf, size_t len);
+
+#endif  // D6T_ROI_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,274 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "d6t-rule.h"
+
+/** <!-- find_zone {{{1 --> zone index by the name, -1 if not defined.
+ */
+static int find_zone(const d6t_rules_t* rs, const char* name) {
+    int z;
+    for (z = 0; z < rs->n_zone; z++) {
+        if (strcmp(rs->zone[z].name, name) == 0) {
+            return z;
+        }
+    }
+    return -1;
+}
+
+/** <!-- parse_zone {{{1 --> `zone name x,y,w,h` or `zone name @mask`.
+ */
+static int parse_zone(d6t_rules_t* rs, char* args, int n_row) {
+    char name[D6T_RULE_NAME], area[256], spec[D6T_RULE_NAME + 256];
+    int i;
+
+    if (sscanf(args, "%15s %255s", name, area) != 2 ||
+        find_zone(rs, name) >= 0 || rs->n_zone >= D6T_RULE_MAX_ZONE) {
+        return -1;
+    }
+    snprintf(spec, sizeof(spec), "%s=%s", name, area);
+    d6t_roi_t* z = &rs->zone[rs->n_zone];
+    if (d6t_roi_parse(z, spec, n_row)) {
+        return -1;
+    }
+    for (i = 0; i < z->n; i++) {
+        if (z->idx[i] >= rs->n_pixel) {
+            return -1;
+        }
+    }
+    rs->n_zone++;
+    return 0;
+}
+
+/** <!-- to_raw {{{1 --> degC to raw units, rounded.
+ */
+static int32_t to_raw(double v, int scale) {
+    v *= scale;
+    return (int32_t)(v >= 0 ? v + 0.5 : v - 0.5);
+}
+
+/** <!-- parse_rule {{{1 --> compile a rule line to the plan.
+ * `rule name agg(zone) [- ptat] >|< degC [for frames] [clear degC]`
+ */
+static int parse_rule(d6t_rules_t* rs, char* args) {
+    char name[D6T_RULE_NAME], agg[8], zone[D6T_RULE_NAME];
+    char* tok;
+    char* save;
+    int r = rs->n_rule, z, kind;
+    double thr, clear;
+    int need = 1;
+    bool rel = false, has_clear = false;
+
+    if (r >= D6T_RULE_MAX ||
+        (tok = strtok_r(args, " \t", &save)) == NULL ||
+        snprintf(name, sizeof(name), "%s", tok) >= (int)sizeof(name) ||
+        (tok = strtok_r(NULL, " \t", &save)) == NULL ||
+        sscanf(tok, "%7[a-z](%15[^)])", agg, zone) != 2 ||
+        (z = find_zone(rs, zone)) < 0) {
+        return -1;
+    }
+    if (strcmp(agg, "min") == 0) {
+        kind = 0;
+    } else if (strcmp(agg, "max") == 0) {
+        kind = 1;
+    } else if (strcmp(agg, "mean") == 0) {
+        kind = 2;
+    } else {
+        return -1;
+    }
+    if ((tok = strtok_r(NULL, " \t", &save)) != NULL &&
+        strcmp(tok, "-") == 0) {
+        if ((tok = strtok_r(NULL, " \t", &save)) == NULL ||
+            strcmp(tok, "ptat") != 0) {
+            return -1;
+        }
+        rel = true;
+        tok = strtok_r(NULL, " \t", &save);
+    }
+    if (tok == NULL || (strcmp(tok, ">") != 0 && strcmp(tok, "<") != 0)) {
+        return -1;
+    }
+    rs->sign[r] = tok[0] == '>' ? 1 : -1;
+    if ((tok = strtok_r(NULL, " \t", &save)) == NULL ||
+        sscanf(tok, "%lf", &thr) != 1) {
+        return -1;
+    }
+    while ((tok = strtok_r(NULL, " \t", &save)) != NULL) {
+        char* val = strtok_r(NULL, " \t", &save);
+        if (val == NULL) {
+            return -1;
+        } else if (strcmp(tok, "for") == 0 && (need = atoi(val)) >= 1) {
+            continue;
+        } else if (strcmp(tok, "clear") == 0 &&
+                   sscanf(val, "%lf", &clear) == 1) {
+            has_clear = true;
+            continue;
+        }
+        return -1;
+    }
+    clear = has_clear ? clear : thr;
+    if (rs->sign[r] * (clear - thr) > 0) {
+        fprintf(stderr, "clear level beyond the threshold: %s\n", name);
+        return -1;
+    }
+
+    // in raw units, the sign folded in, a mean by the sum.
+    int32_t mul = kind == 2 ? rs->zone[z].n : 1;
+    memcpy(rs->name[r], name, sizeof(name));
+    rs->used[z] = true;
+    rs->slot[r] = (uint16_t)(z * 3 + kind);
+    rs->mul[r] = mul;
+    rs->rel[r] = rel ? mul : 0;
+    rs->thr[r] = rs->sign[r] * to_raw(thr, rs->scale) * mul;
+    rs->clear[r] = rs->sign[r] * to_raw(clear, rs->scale) * mul;
+    rs->need[r] = need;
+    rs->n_rule++;
+    return 0;
+}
+
+/** <!-- d6t_rules_load {{{1 --> read a rule file.
+ * zones are rectangles or masks as the ROI options, `all` is predefined:
+ *
+ *   zone door 12,0,8,32
+ *   rule hot max(door) > 45.0 for 3 clear 43.0
+ *   rule warm mean(all) - ptat > 5.0
+ *
+ * a rule is raised when its condition holds for `for` frames (default 1)
+ * and cleared when the value is back to the clear level (default the
+ * threshold). scale is the raw units per degC of the pixels.
+ */
+int d6t_rules_load(d6t_rules_t* rs, const char* path, int n_row,
+                   int n_pixel, int scale) {
+    char line[512], kw[8];
+    int n_line = 0, i, pos;
+    FILE* fp = fopen(path, "r");
+
+    memset(rs, 0, sizeof(*rs));
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        return -1;
+    }
+    rs->n_pixel = n_pixel;
+    rs->scale = scale;
+    snprintf(rs->zone[0].name, D6T_RULE_NAME, "all");
+    for (i = 0; i < n_pixel; i++) {
+        rs->zone[0].idx[i] = (uint16_t)i;
+    }
+    rs->zone[0].n = n_pixel;
+    rs->n_zone = 1;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char* hash = strchr(line, '#');
+        int ret = 0;
+        n_line++;
+        if (hash != NULL) {
+            *hash = '\0';
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        if (sscanf(line, " %7s %n", kw, &pos) != 1) {
+            continue;  // blank or comment.
+        }
+        if (strcmp(kw, "zone") == 0) {
+            ret = parse_zone(rs, line + pos, n_row);
+        } else if (strcmp(kw, "rule") == 0) {
+            ret = parse_rule(rs, line + pos);
+        } else {
+            ret = -1;
+        }
+        if (ret) {
+            fprintf(stderr, "%s:%d: invalid zone or rule\n", path, n_line);
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/** <!-- d6t_rules_eval {{{1 --> evaluate the rules on a frame.
+ * ptat and pix are in raw units, the raised and cleared rules are
+ * listed in rs->event. returns the number of the events.
+ */
+int d6t_rules_eval(d6t_rules_t* rs, int16_t ptat, const int16_t* pix) {
+    int z, r, i;
+    int32_t any = 0;
+    int32_t p = (int32_t)ptat * rs->scale / 10;  // PTAT in pixel units
+
+    for (z = 0; z < rs->n_zone; z++) {
+        if (!rs->used[z]) {
+            continue;
+        }
+        const d6t_roi_t* zone = &rs->zone[z];
+        int32_t lo = pix[zone->idx[0]], hi = lo, sum = 0;
+        for (i = 0; i < zone->n; i++) {
+            int32_t v = pix[zone->idx[i]];
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+            sum += v;
+        }
+        rs->stat[z * 3] = lo;
+        rs->stat[z * 3 + 1] = hi;
+        rs->stat[z * 3 + 2] = sum;
+    }
+    for (r = 0; r < rs->n_rule; r++) {
+        int32_t s = rs->sign[r] * (rs->stat[rs->slot[r]] - rs->rel[r] * p);
+        int32_t over = s > rs->thr[r];
+        int32_t n = rs->count[r] < rs->need[r] ? rs->count[r] + 1
+                  : rs->need[r];
+        int32_t raise = !rs->active[r] & (n * over >= rs->need[r]);
+        int32_t drop = rs->active[r] & (s <= rs->clear[r]);
+        rs->count[r] = n * over;
+        rs->value[r] = s;
+        rs->active[r] ^= raise | drop;
+        rs->changed[r] = raise | drop;
+        any |= raise | drop;
+    }
+    rs->n_event = 0;
+    for (r = 0; r < rs->n_rule && any; r++) {
+        if (rs->changed[r]) {
+            rs->event[rs->n_event++] = (uint16_t)r;
+        }
+    }
+    return rs->n_event;
+}
+
+/** <!-- d6t_rules_sprint {{{1 --> format the event k of the last frame.
+ * `ALARM: TS: sec.nsec [s], Rule: name, Raised|Cleared, Value: degC`
+ * returns the line length, or -1 if the buffer is too short.
+ */
+int d6t_rules_sprint(const d6t_rules_t* rs, int k, int64_t ts_ns,
+                     char* buf, size_t len) {
+    int r = rs->event[k];
+    double v = (double)(rs->sign[r] * rs->value[r]) / rs->mul[r] / rs->scale;
+    int n = snprintf(buf, len, "ALARM: TS: %lld.%09lld [s], Rule: %s, %s,"
+                     " Value: %4.1f [degC]\n",
+                     (long long)(ts_ns / 1000000000),
+                     (long long)(ts_ns % 1000000000), rs->name[r],
+                     rs->active[r] ? "Raised" : "Cleared", v);
+    return n < 0 || (size_t)n >= len ? -1 : n;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_RULE_H_
+#define D6T_RULE_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "d6t-roi.h"
+
+/* defines */
+#define D6T_RULE_MAX 1024
+#define D6T_RULE_MAX_ZONE 32
+#define D6T_RULE_NAME D6T_ROI_NAME
+
+/** <!-- d6t_rules_t {{{1 --> rules compiled to an evaluation plan.
+ * the statistics (min, max and sum) of each zone are computed once per
+ * frame, then the rules are evaluated by a loop without branches over
+ * the plan columns, all in raw pixel units. a mean is compared by the
+ * sum against the threshold multiplied by the zone size.
+ */
+typedef struct d6t_rules {
+    int n_pixel;
+    int scale;              // raw units per degC (10, or 5 for D6T-8LH)
+    int n_zone;             // zone 0 is `all`
+    d6t_roi_t zone[D6T_RULE_MAX_ZONE];
+    bool used[D6T_RULE_MAX_ZONE];
+    int32_t stat[D6T_RULE_MAX_ZONE * 3];  // min, max, sum of each zone
+    int n_rule;
+    char name[D6T_RULE_MAX][D6T_RULE_NAME];
+    /* plan, a column per field */
+    uint16_t slot[D6T_RULE_MAX];    // index into stat
+    int32_t mul[D6T_RULE_MAX];      // zone size for a mean, else 1
+    int32_t rel[D6T_RULE_MAX];      // mul if relative to PTAT, else 0
+    int32_t sign[D6T_RULE_MAX];     // 1 for `>`, -1 for `<`
+    int32_t thr[D6T_RULE_MAX];      // sign * threshold * mul
+    int32_t clear[D6T_RULE_MAX];    // sign * clear level * mul
+    int32_t need[D6T_RULE_MAX];     // consecutive frames to raise
+    /* state */
+    int32_t count[D6T_RULE_MAX];
+    int32_t active[D6T_RULE_MAX];
+    int32_t value[D6T_RULE_MAX];    // last sign * value * mul
+    int32_t changed[D6T_RULE_MAX];  // raised or cleared by the last frame
+    /* events of the last frame */
+    int n_event;
+    uint16_t event[D6T_RULE_MAX];
+} d6t_rules_t;
+
+int d6t_rules_load(d6t_rules_t* rs, const char* path, int n_row,
+                   int n_pixel, int scale);
+int d6t_rules_eval(d6t_rules_t* rs, int16_t ptat, const int16_t* pix);
+int d6t_rules_sprint(const d6t_rules_t* rs, int k, int64_t ts_ns,
+                     char* buf, size_t len);
+
+#endif  // D6T_RULE_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
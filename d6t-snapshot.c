@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "d6t-stamp.h"
+#include "d6t-align.h"
+
+/* sensor streams */
+static struct {
+    FILE* fp;
+    long seq;           // frames read
+    bool pending;       // a frame is read and not queued yet
+    int64_t ts_ns;
+    char* line[D6T_ALIGN_DEPTH];
+    size_t cap[D6T_ALIGN_DEPTH];
+} streams[D6T_ALIGN_MAX_SENSOR];
+
+/** <!-- read_frame {{{1 --> read the next stamped frame of a stream.
+ * lines without a stamp (e.g. diagnostics) are skipped.
+ */
+static void read_frame(int s) {
+    int32_t dur;
+    int slot = (int)(streams[s].seq % D6T_ALIGN_DEPTH);
+    streams[s].pending = false;
+    while (getline(&streams[s].line[slot], &streams[s].cap[slot],
+                   streams[s].fp) > 0) {
+        if (d6t_stamp_parse(streams[s].line[slot],
+                            &streams[s].ts_ns, &dur) == 0) {
+            streams[s].pending = true;
+            return;
+        }
+    }
+}
+
+/** <!-- main - multi-sensor snapshots {{{1 -->
+ * group the frames of several sensor outputs, recorded with `-T`,
+ * into snapshots with a frame of each sensor within the tolerance.
+ *
+ * options:
+ *   -w msec:     tolerance of the frame timestamps (default 50).
+ */
+int main(int argc, char* argv[]) {
+    int opt, s, n;
+    double tolerance = 50.0;
+    static d6t_align_t align;
+    d6t_snapshot_t snap;
+
+    while ((opt = getopt(argc, argv, "w:")) != -1) {
+        switch (opt) {
+        case 'w': tolerance = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-w msec] log1 log2 ...\n", argv[0]);
+            return 1;
+        }
+    }
+    n = argc - optind;
+    if (n < 1 || d6t_align_init(&align, n, (int64_t)(tolerance * 1e6))) {
+        fprintf(stderr, "usage: %s [-w msec] log1 ... log%d\n",
+                argv[0], D6T_ALIGN_MAX_SENSOR);
+        return 1;
+    }
+    for (s = 0; s < n; s++) {
+        streams[s].fp = fopen(argv[optind + s], "r");
+        if (streams[s].fp == NULL) {
+            fprintf(stderr, "Failed to open: %s\n", argv[optind + s]);
+            return 1;
+        }
+        read_frame(s);
+    }
+
+    for (;;) {
+        int next = -1;
+        for (s = 0; s < n; s++) {  // feed the frames in the time order.
+            if (streams[s].pending &&
+                (next < 0 || streams[s].ts_ns < streams[next].ts_ns)) {
+                next = s;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        d6t_align_push(&align, next, streams[next].ts_ns, streams[next].seq);
+        streams[next].seq++;
+        while (d6t_align_pop(&align, &snap)) {
+            printf("SNAP: TS: %lld.%09lld [s], Spread: %d [us]\n",
+                   (long long)(snap.ts_ns / 1000000000),
+                   (long long)(snap.ts_ns % 1000000000),
+                   (int)(snap.spread_ns / 1000));
+            for (s = 0; s < n; s++) {
+                printf("[%d] %s", s,
+                       streams[s].line[snap.token[s] % D6T_ALIGN_DEPTH]);
+            }
+        }
+        read_frame(next);
+    }
+
+    fprintf(stderr, "snapshots: %ld, dropped frames: %ld\n",
+            align.n_snapshot, align.n_dropped);
+    for (s = 0; s < n; s++) {
+        int k;
+        for (k = 0; k < D6T_ALIGN_DEPTH; k++) {
+            free(streams[s].line[k]);
+        }
+        fclose(streams[s].fp);
+    }
+    return 0;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
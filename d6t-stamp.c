@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "d6t-stamp.h"
+
+/** <!-- clock_ns {{{1 --> read a clock in nanoseconds.
+ */
+static int64_t clock_ns(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** <!-- d6t_stamp_begin {{{1 --> call just before the I2C transfer.
+ */
+void d6t_stamp_begin(d6t_stamp_t* s) {
+    s->begin_ns = clock_ns(CLOCK_MONOTONIC);
+}
+
+/** <!-- d6t_stamp_end {{{1 --> call just after the I2C transfer.
+ */
+void d6t_stamp_end(d6t_stamp_t* s) {
+    s->end_ns = clock_ns(CLOCK_MONOTONIC);
+    s->real_ns = clock_ns(CLOCK_REALTIME);
+}
+
+/** <!-- d6t_stamp_mid {{{1 --> midpoint of the transfer, monotonic.
+ */
+int64_t d6t_stamp_mid(const d6t_stamp_t* s) {
+    return s->begin_ns + (s->end_ns - s->begin_ns) / 2;
+}
+
+/** <!-- d6t_stamp_real_mid {{{1 --> midpoint of the transfer, realtime.
+ */
+int64_t d6t_stamp_real_mid(const d6t_stamp_t* s) {
+    return s->real_ns - (s->end_ns - s->begin_ns) / 2;
+}
+
+/** <!-- d6t_stamp_dur {{{1 --> duration of the transfer.
+ */
+int32_t d6t_stamp_dur(const d6t_stamp_t* s) {
+    return (int32_t)(s->end_ns - s->begin_ns);
+}
+
+/** <!-- d6t_stamp_sprint {{{1 --> format the stamp as a line prefix.
+ * `TS: sec.nsec [s], Read: usec [us], ` with the monotonic midpoint,
+ * `Real: sec.nsec [s], ` follows if real is true.
+ */
+int d6t_stamp_sprint(const d6t_stamp_t* s, bool real, char* buf, size_t len) {
+    int64_t mid = d6t_stamp_mid(s);
+    int n = snprintf(buf, len, "TS: %lld.%09lld [s], Read: %d [us], ",
+                     (long long)(mid / 1000000000),
+                     (long long)(mid % 1000000000),
+                     (int)(d6t_stamp_dur(s) / 1000));
+    if (real && n >= 0 && (size_t)n < len) {
+        int64_t rmid = d6t_stamp_real_mid(s);
+        n += snprintf(buf + n, len - n, "Real: %lld.%09lld [s], ",
+                      (long long)(rmid / 1000000000),
+                      (long long)(rmid % 1000000000));
+    }
+    return n < 0 || (size_t)n >= len ? -1 : n;
+}
+
+/** <!-- d6t_stamp_parse {{{1 --> read the stamp back from a line.
+ * returns 0, or -1 if the line has no stamp.
+ */
+int d6t_stamp_parse(const char* line, int64_t* mid_ns, int32_t* dur_ns) {
+    const char* p = strstr(line, "TS:");
+    char* end;
+    int64_t frac = 0;
+    int digits = 0;
+
+    if (p == NULL) {
+        return -1;
+    }
+    *mid_ns = (int64_t)strtoll(p + 3, &end, 10) * 1000000000;
+    if (*end == '.') {
+        for (end++; *end >= '0' && *end <= '9'; end++) {
+            if (digits++ < 9) {
+                frac = frac * 10 + (*end - '0');
+            }
+        }
+    }
+    for (; digits < 9; digits++) {
+        frac *= 10;
+    }
+    *mid_ns += frac;
+    *dur_ns = 0;
+    if ((p = strstr(end, "Read:")) != NULL) {
+        *dur_ns = (int32_t)strtol(p + 5, NULL, 10) * 1000;
+    }
+    return 0;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,51 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_STAMP_H_
+#define D6T_STAMP_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** <!-- d6t_stamp_t {{{1 --> acquisition time of a frame.
+ * CLOCK_MONOTONIC just before and after the I2C transfer,
+ * and CLOCK_REALTIME just after it.
+ */
+typedef struct d6t_stamp {
+    int64_t begin_ns;
+    int64_t end_ns;
+    int64_t real_ns;
+} d6t_stamp_t;
+
+void d6t_stamp_begin(d6t_stamp_t* s);
+void d6t_stamp_end(d6t_stamp_t* s);
+int64_t d6t_stamp_mid(const d6t_stamp_t* s);
+int64_t d6t_stamp_real_mid(const d6t_stamp_t* s);
+int32_t d6t_stamp_dur(const d6t_stamp_t* s);
+int d6t_stamp_sprint(const d6t_stamp_t* s, bool real, char* buf, size_t len);
+int d6t_stamp_parse(const char* line, int64_t* mid_ns, int32_t* dur_ns);
+
+#endif  // D6T_STAMP_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
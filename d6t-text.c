@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "d6t-text.h"
+
+/** <!-- d6t_text_init {{{1 --> start an empty line in buf.
+ */
+void d6t_text_init(d6t_text_t* t, char* buf, size_t len) {
+    t->buf = buf;
+    t->len = len;
+    t->pos = 0;
+    t->truncated = len == 0;
+    if (len > 0) {
+        buf[0] = '\0';
+    }
+}
+
+/** <!-- d6t_text_put {{{1 --> append a printf formatted piece.
+ */
+void d6t_text_put(d6t_text_t* t, const char* fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (t->truncated) {
+        return;
+    }
+    va_start(ap, fmt);
+    n = vsnprintf(t->buf + t->pos, t->len - t->pos, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= t->len - t->pos) {
+        t->truncated = true;
+        return;
+    }
+    t->pos += n;
+}
+
+/** <!-- d6t_text_end {{{1 --> the line length, or -1 if truncated.
+ */
+int d6t_text_end(const d6t_text_t* t) {
+    return t->truncated ? -1 : (int)t->pos;
+}
+
+/** <!-- d6t_text_parse_value {{{1 --> parse a `%4.1f, ` field.
+ * the value in raw units (0.1 degC), the field and the separator are
+ * skipped. returns -1 if not a number.
+ */
+int d6t_text_parse_value(const char** p, int16_t* v) {
+    char* end;
+    double f = strtod(*p, &end);
+    if (end == *p) {
+        return -1;
+    }
+    f *= 10.0;
+    *v = (int16_t)(f >= 0 ? f + 0.5 : f - 0.5);
+    while (*end == ',' || *end == ' ') {
+        end++;
+    }
+    *p = end;
+    return 0;
+}
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
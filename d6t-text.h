@@ -0,0 +1,51 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_TEXT_H_
+#define D6T_TEXT_H_
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** <!-- d6t_text_t {{{1 --> a line formatted into a caller buffer.
+ * the pieces are appended by d6t_text_put(), a piece which does not fit
+ * marks the line as truncated and the later pieces are ignored, so the
+ * caller checks d6t_text_end() once.
+ */
+typedef struct d6t_text {
+    char* buf;
+    size_t len;         // buffer size
+    size_t pos;         // line length
+    bool truncated;
+} d6t_text_t;
+
+void d6t_text_init(d6t_text_t* t, char* buf, size_t len);
+void d6t_text_put(d6t_text_t* t, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+int d6t_text_end(const d6t_text_t* t);
+int d6t_text_parse_value(const char** p, int16_t* v);
+
+#endif  // D6T_TEXT_H_
+// vi: ft=c:fdm=marker:et:sw=4:tw=80
@@ -0,0 +1,325 @@
+/*
+ * MIT License
+ * Copyright (c) 2019, 2018 - present OMRON Corporation
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef D6T_HPP_
+#define D6T_HPP_
+
+/* includes */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <time.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/** <!-- d6t {{{1 --> header-only C++17 API of the D6T samples.
+ * the models differ only by the constants in their traits, frames are
+ * sized by the traits and live on the caller's stack, no heap and no
+ * global state, so any number of sensors can run in a process.
+ *
+ *   d6t::Sensor<d6t::D6T_44L> sensor("/dev/i2c-1");
+ *   d6t::Frame<d6t::D6T_44L> frame;
+ *   sensor.init();
+ *   if (sensor.read(&frame) == 0) {... frame.pix[0] ...}
+ */
+namespace d6t {
+
+constexpr uint8_t kAddr = 0x0A;  // I2C 7bit address
+
+/** <!-- InitStep {{{1 --> a register write of an init sequence.
+ */
+struct InitStep {
+    uint8_t len;
+    uint8_t data[4];
+};
+
+/* model traits {{{1 */
+struct D6T_1A {
+    static constexpr const char* name = "d6t-1a";
+    static constexpr int n_row = 1, n_col = 1;
+    static constexpr uint8_t cmd = 0x4C;
+    static constexpr int scale = 10;  // raw pixel units per degC
+    static constexpr int power_on_ms = 220, settle_ms = 0;
+    static constexpr int interval_ms = 100;
+    static constexpr int read_gap_ms = 0;  // write, then read.
+    static constexpr std::array<InitStep, 0> init = {};
+};
+
+struct D6T_8L {
+    static constexpr const char* name = "d6t-8l";
+    static constexpr int n_row = 1, n_col = 8;
+    static constexpr uint8_t cmd = 0x4C;
+    static constexpr int scale = 10;
+    static constexpr int power_on_ms = 20, settle_ms = 500;
+    static constexpr int interval_ms = 250;
+    static constexpr int read_gap_ms = 0;
+    static constexpr std::array<InitStep, 5> init = {{
+        {4, {0x02, 0x00, 0x01, 0xee}},
+        {4, {0x05, 0x90, 0x3a, 0xb8}},
+        {4, {0x03, 0x00, 0x03, 0x8b}},
+        {4, {0x03, 0x00, 0x07, 0x97}},
+        {4, {0x02, 0x00, 0x00, 0xe9}},
+    }};
+};
+
+struct D6T_8LH : D6T_8L {
+    static constexpr const char* name = "d6t-8lh";
+    static constexpr int scale = 5;
+    static constexpr int settle_ms = 500 + 500;
+};
+
+struct D6T_44L {
+    static constexpr const char* name = "d6t-44l";
+    static constexpr int n_row = 4, n_col = 4;
+    static constexpr uint8_t cmd = 0x4C;
+    static constexpr int scale = 10;
+    static constexpr int power_on_ms = 620, settle_ms = 0;
+    static constexpr int interval_ms = 300;
+    static constexpr int read_gap_ms = 1;
+    static constexpr std::array<InitStep, 0> init = {};
+};
+
+struct D6T_32L {
+    static constexpr const char* name = "d6t-32l";
+    static constexpr int n_row = 32, n_col = 32;
+    static constexpr uint8_t cmd = 0x4D;
+    static constexpr int scale = 10;
+    static constexpr int power_on_ms = 350, settle_ms = 390;
+    static constexpr int interval_ms = 200;
+    static constexpr int read_gap_ms = -1;  // I2C_RDWR, repeated start.
+    // same bytes as initialSetting() of d6t-32l.c sends.
+    static constexpr std::array<InitStep, 1> init = {{
+        {2, {0x01, 0x01}},
+    }};
+};
+
+/* derived constants {{{1 */
+template <class M> constexpr int n_pixel = M::n_row * M::n_col;
+template <class M> constexpr int n_read = (n_pixel<M> + 1) * 2 + 1;
+
+template <class M> using ReadBuffer = std::array<uint8_t, n_read<M>>;
+
+/** <!-- Frame {{{1 --> a decoded frame in raw units (1/scale degC).
+ */
+template <class M> struct Frame {
+    int16_t ptat;  // 0.1 degC
+    std::array<int16_t, n_pixel<M>> pix;
+};
+
+/** <!-- Stats {{{1 --> statistics of a frame in raw units.
+ */
+struct Stats {
+    int16_t min, max;
+    int32_t sum;
+    int argmax;
+};
+
+/** <!-- crc8 {{{1 --> the PEC step of a byte, same as calc_crc().
+ */
+constexpr uint8_t crc8(uint8_t data) {
+    for (int i = 0; i < 8; i++) {
+        data = (data & 0x80) ? (uint8_t)((data << 1) ^ 0x07)
+                             : (uint8_t)(data << 1);
+    }
+    return data;
+}
+
+/** <!-- crc_table {{{1 --> PEC steps of all bytes, built at compile time.
+ */
+constexpr std::array<uint8_t, 256> crc_table = [] {
+    std::array<uint8_t, 256> t{};
+    for (int i = 0; i < 256; i++) {
+        t[i] = crc8((uint8_t)i);
+    }
+    return t;
+}();
+
+/** <!-- pec_ok {{{1 --> PEC check of a read buffer.
+ * returns true if the PEC matches (the reverse of D6T_checkPEC()).
+ */
+template <class M> bool pec_ok(const ReadBuffer<M>& buf) {
+    uint8_t crc = crc_table[(kAddr << 1) | 1];  // I2C Read address (8bit)
+    for (int i = 0; i < n_read<M> - 1; i++) {
+        crc = crc_table[buf[i] ^ crc];
+    }
+    return crc == buf[n_read<M> - 1];
+}
+
+/** <!-- to_s16 {{{1 --> convert a 16bit data from the byte stream.
+ */
+constexpr int16_t to_s16(const uint8_t* p) {
+    return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+namespace detail {
+template <class M, std::size_t... I>
+inline void decode_unrolled(const uint8_t* p, int16_t* out,
+                            std::index_sequence<I...>) {
+    ((out[I] = to_s16(p + 2 * I)), ...);
+}
+}  // namespace detail
+
+/** <!-- decode {{{1 --> convert a read buffer to a frame.
+ * small models are fully unrolled, the 32x32 loop has a compile-time
+ * trip count to be vectorized.
+ */
+template <class M> void decode(const ReadBuffer<M>& buf, Frame<M>* f) {
+    f->ptat = to_s16(buf.data());
+    if constexpr (n_pixel<M> <= 16) {
+        detail::decode_unrolled<M>(buf.data() + 2, f->pix.data(),
+                                   std::make_index_sequence<n_pixel<M>>{});
+    } else {
+        for (int i = 0; i < n_pixel<M>; i++) {
+            f->pix[i] = to_s16(buf.data() + 2 + 2 * i);
+        }
+    }
+}
+
+/** <!-- stats {{{1 --> min, max, sum and hottest pixel of a frame.
+ */
+template <class M> Stats stats(const Frame<M>& f) {
+    Stats s = {f.pix[0], f.pix[0], 0, 0};
+    for (int i = 0; i < n_pixel<M>; i++) {
+        s.min = f.pix[i] < s.min ? f.pix[i] : s.min;
+        s.max = f.pix[i] > s.max ? f.pix[i] : s.max;
+        s.sum += f.pix[i];
+    }
+    for (int i = 0; i < n_pixel<M>; i++) {  // separate loop to vectorize above.
+        if (f.pix[i] == s.max) {
+            s.argmax = i;
+            break;
+        }
+    }
+    return s;
+}
+
+/** <!-- degc {{{1 --> convert raw pixel units to degC.
+ */
+template <class M> constexpr double degc(int16_t raw) {
+    return (double)raw / M::scale;
+}
+
+/** <!-- delay {{{1 --> sleep in milliseconds.
+ */
+inline void delay(int msec) {
+    struct timespec ts = {msec / 1000, (msec % 1000) * 1000000L};
+    nanosleep(&ts, nullptr);
+}
+
+/** <!-- Sensor {{{1 --> a sensor on an I2C bus.
+ * holds only the device path, the bus is opened for each transfer
+ * as the C samples do.
+ */
+template <class M> class Sensor {
+ public:
+    explicit Sensor(const char* dev = "/dev/i2c-1") : dev_(dev) {}
+
+    /** sleep the power-on time, write the init sequence and settle.
+     * returns 0 or the I2C error code of the C samples (21-23).
+     */
+    int init() const {
+        delay(M::power_on_ms);
+        for (const InitStep& step : M::init) {
+            int err = write(step.data, step.len);
+            if (err) {
+                return err;
+            }
+        }
+        delay(M::settle_ms);
+        return 0;
+    }
+
+    /** read a frame, returns 0, 21-25 for I2C errors, 26 for PEC. */
+    int read(ReadBuffer<M>* buf) const {
+        int fd = open(dev_, O_RDWR);
+        if (fd < 0) {
+            return 21;
+        }
+        uint8_t reg = M::cmd;
+        int err = 0;
+        if constexpr (M::read_gap_ms < 0) {
+            struct i2c_msg messages[] = {
+                {kAddr, 0, 1, &reg},
+                {kAddr, I2C_M_RD, (uint16_t)n_read<M>, buf->data()},
+            };
+            struct i2c_rdwr_ioctl_data ioctl_data = {messages, 2};
+            if (ioctl(fd, I2C_RDWR, &ioctl_data) != 2) {
+                err = 24;
+            }
+        } else {
+            if (ioctl(fd, I2C_SLAVE, kAddr) < 0) {
+                err = 22;
+            } else if (::write(fd, &reg, 1) != 1) {
+                err = 23;
+            } else {
+                if constexpr (M::read_gap_ms > 0) {
+                    delay(M::read_gap_ms);
+                }
+                int count = ::read(fd, buf->data(), n_read<M>);
+                err = count < 0 ? 24 : count != n_read<M> ? 25 : 0;
+            }
+        }
+        close(fd);
+        if (err) {
+            return err;
+        }
+        return pec_ok<M>(*buf) ? 0 : 26;
+    }
+
+    int read(Frame<M>* f) const {
+        ReadBuffer<M> buf;
+        int err = read(&buf);
+        if (err == 0) {
+            decode<M>(buf, f);
+        }
+        return err;
+    }
+
+ private:
+    int write(const uint8_t* data, int len) const {
+        int fd = open(dev_, O_RDWR);
+        if (fd < 0) {
+            return 21;
+        }
+        int err = 0;
+        if (ioctl(fd, I2C_SLAVE, kAddr) < 0) {
+            err = 22;
+        } else if (::write(fd, data, len) != len) {
+            err = 23;
+        }
+        close(fd);
+        return err;
+    }
+
+    const char* dev_;
+};
+
+}  // namespace d6t
+
+#endif  // D6T_HPP_
+// vi: ft=cpp:fdm=marker:et:sw=4:tw=80